@@ -0,0 +1,239 @@
+/* DnsCache
+ * Copyright (c) 2017 MXCHIP Information Tech. Co.,Ltd
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "DnsCache.h"
+
+DnsCache::DnsCache(NetworkInterface *net, uint32_t ttl_ms, uint32_t negative_ttl_ms)
+    : _net(net), _ttl_ms(ttl_ms), _negative_ttl_ms(negative_ttl_ms), _prefetch_queue(NULL), _prefetch_id(0)
+{
+    _clock.start();
+    flush();
+    reset_stats();
+}
+
+DnsCache::DnsCache(Resolver resolver, uint32_t ttl_ms, uint32_t negative_ttl_ms)
+    : _net(NULL), _resolver(resolver), _ttl_ms(ttl_ms), _negative_ttl_ms(negative_ttl_ms),
+      _prefetch_queue(NULL), _prefetch_id(0)
+{
+    _clock.start();
+    flush();
+    reset_stats();
+}
+
+DnsCache::~DnsCache()
+{
+    stop_prefetch();
+}
+
+uint64_t DnsCache::now_ms()
+{
+    return _clock.read_high_resolution_us() / 1000;
+}
+
+void DnsCache::flush()
+{
+    _mutex.lock();
+    for (int i = 0; i < DNS_CACHE_ENTRIES; i++) {
+        _entries[i].host[0] = '\0';
+        _entries[i].refresh = false;
+    }
+    _mutex.unlock();
+}
+
+void DnsCache::reset_stats()
+{
+    memset(&_stats, 0, sizeof(_stats));
+}
+
+DnsCache::Entry *DnsCache::find(const char *host)
+{
+    for (int i = 0; i < DNS_CACHE_ENTRIES; i++) {
+        if (_entries[i].host[0] && strcmp(_entries[i].host, host) == 0) {
+            return &_entries[i];
+        }
+    }
+    return NULL;
+}
+
+nsapi_error_t DnsCache::resolve(const char *host, SocketAddress *address)
+{
+    if (_resolver) {
+        return _resolver(host, address);
+    }
+    return _net->gethostbyname(host, address);
+}
+
+void DnsCache::store(const char *host, const SocketAddress &address, nsapi_error_t result)
+{
+    if (result != NSAPI_ERROR_OK && _negative_ttl_ms == 0) {
+        return;
+    }
+
+    uint64_t now = now_ms();
+    Entry *e = find(host);
+    if (!e) {
+        /* Take an empty or expired entry, else the least recently used one */
+        e = &_entries[0];
+        for (int i = 0; i < DNS_CACHE_ENTRIES; i++) {
+            Entry *c = &_entries[i];
+            if (!c->host[0] || c->expires_ms <= now) {
+                e = c;
+                break;
+            }
+            if (c->used_ms < e->used_ms) {
+                e = c;
+            }
+        }
+        if (e->host[0] && e->expires_ms > now) {
+            _stats.evictions++;
+        }
+        strcpy(e->host, host);
+        e->used_ms = now;
+    }
+
+    e->address = address;
+    e->result = result;
+    e->expires_ms = now + (result == NSAPI_ERROR_OK ? _ttl_ms : _negative_ttl_ms);
+    e->refresh = false;
+}
+
+nsapi_error_t DnsCache::lookup(const char *host, SocketAddress *address)
+{
+    /* Address literals need no lookup */
+    SocketAddress literal;
+    if (literal.set_ip_address(host)) {
+        address->set_ip_address(literal.get_ip_address());
+        return NSAPI_ERROR_OK;
+    }
+
+    if (strlen(host) >= DNS_CACHE_HOST_SIZE) {
+        _stats.misses++;
+        return resolve(host, address);
+    }
+
+    _mutex.lock();
+    uint64_t now = now_ms();
+    Entry *e = find(host);
+    if (e && e->expires_ms > now) {
+        nsapi_error_t result = e->result;
+        if (result == NSAPI_ERROR_OK) {
+            address->set_ip_address(e->address.get_ip_address());
+            _stats.hits++;
+        } else {
+            _stats.negative_hits++;
+        }
+        e->used_ms = now;
+        if (result == NSAPI_ERROR_OK && e->expires_ms - now < DNS_CACHE_PREFETCH_MS) {
+            e->refresh = true;
+        }
+        _mutex.unlock();
+        return result;
+    }
+    _stats.misses++;
+    _mutex.unlock();
+
+    /* Not under the lock, a lookup may take seconds */
+    SocketAddress resolved;
+    nsapi_error_t result = resolve(host, &resolved);
+
+    _mutex.lock();
+    if (result != NSAPI_ERROR_OK) {
+        _stats.failures++;
+    }
+    store(host, resolved, result);
+    _mutex.unlock();
+
+    if (result == NSAPI_ERROR_OK) {
+        address->set_ip_address(resolved.get_ip_address());
+    }
+    return result;
+}
+
+nsapi_error_t DnsCache::connect(TCPSocket *socket, const char *host, uint16_t port)
+{
+    SocketAddress address;
+
+    nsapi_error_t err = lookup(host, &address);
+    if (err != NSAPI_ERROR_OK) {
+        return err;
+    }
+    address.set_port(port);
+    return socket->connect(address);
+}
+
+int DnsCache::prefetch()
+{
+    char host[DNS_CACHE_HOST_SIZE];
+    int refreshed = 0;
+
+    for (int i = 0; i < DNS_CACHE_ENTRIES; i++) {
+        _mutex.lock();
+        Entry *e = &_entries[i];
+        bool due = e->host[0] && e->refresh;
+        if (due) {
+            strcpy(host, e->host);
+            e->refresh = false;
+        }
+        _mutex.unlock();
+        if (!due) {
+            continue;
+        }
+
+        SocketAddress resolved;
+        nsapi_error_t result = resolve(host, &resolved);
+
+        _mutex.lock();
+        /* On failure the old answer stays until it expires */
+        if (result == NSAPI_ERROR_OK) {
+            store(host, resolved, result);
+            _stats.prefetches++;
+            refreshed++;
+        } else {
+            _stats.failures++;
+        }
+        _mutex.unlock();
+    }
+
+    return refreshed;
+}
+
+nsapi_error_t DnsCache::start_prefetch(EventQueue *queue, int period_ms)
+{
+    stop_prefetch();
+    _prefetch_id = queue->call_every(period_ms, this, &DnsCache::prefetch);
+    if (_prefetch_id == 0) {
+        return NSAPI_ERROR_NO_MEMORY;
+    }
+    _prefetch_queue = queue;
+    return NSAPI_ERROR_OK;
+}
+
+void DnsCache::stop_prefetch()
+{
+    if (_prefetch_queue) {
+        _prefetch_queue->cancel(_prefetch_id);
+        _prefetch_queue = NULL;
+        _prefetch_id = 0;
+    }
+}
+
+void DnsCache::print_stats(const char *title) const
+{
+    printf("%s: %lu hits, %lu negative hits, %lu misses, %lu failures, %lu prefetches, %lu evictions\r\n",
+           title, (unsigned long)_stats.hits, (unsigned long)_stats.negative_hits,
+           (unsigned long)_stats.misses, (unsigned long)_stats.failures,
+           (unsigned long)_stats.prefetches, (unsigned long)_stats.evictions);
+}
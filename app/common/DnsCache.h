@@ -0,0 +1,162 @@
+/* DnsCache
+ * Copyright (c) 2017 MXCHIP Information Tech. Co.,Ltd
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef DNS_CACHE_H
+#define DNS_CACHE_H
+
+#include "mbed.h"
+#include "TCPSocket.h"
+#include "EventQueue.h"
+
+/* Number of host names kept, the least recently used one is replaced */
+#define DNS_CACHE_ENTRIES           8
+
+/* Longest host name cached, longer names are always resolved */
+#define DNS_CACHE_HOST_SIZE         64
+
+/* Lifetime of a resolved and of a failed lookup */
+#define DNS_CACHE_TTL_MS            (5 * 60 * 1000)
+#define DNS_CACHE_NEGATIVE_TTL_MS   (10 * 1000)
+
+/* Entries used within this long of expiry are refreshed by prefetch() */
+#define DNS_CACHE_PREFETCH_MS       (30 * 1000)
+
+/* Period of start_prefetch(), well inside DNS_CACHE_PREFETCH_MS */
+#define DNS_CACHE_PREFETCH_PERIOD_MS (10 * 1000)
+
+/** DnsCache
+ *  Fixed-size host name cache in front of NetworkInterface::gethostbyname.
+ *
+ *  The network stack does not report the TTL of a DNS answer, so every
+ *  answer lives for the TTL given to the constructor. Failed lookups are
+ *  cached for a shorter negative TTL so a missing name does not cost a
+ *  DNS timeout on every connect. Entries that are looked up close to
+ *  expiry are marked; prefetch() resolves them again off the connect path.
+ *  start_prefetch() runs it periodically on an EventQueue, whose thread
+ *  then blocks for the lookups, so a queue of its own is best.
+ *
+ *  The resolver can be replaced, e.g. to run the cache on a host against a
+ *  stub DNS server.
+ */
+class DnsCache {
+public:
+    typedef Callback<nsapi_error_t(const char *, SocketAddress *)> Resolver;
+
+    /** Lookup statistics, all counters since construction or reset_stats() */
+    struct Stats {
+        uint32_t hits;          /**< Answered from a valid entry */
+        uint32_t negative_hits; /**< Answered from a cached failure */
+        uint32_t misses;        /**< Sent to the resolver */
+        uint32_t failures;      /**< Resolver errors */
+        uint32_t prefetches;    /**< Entries refreshed by prefetch() */
+        uint32_t evictions;     /**< Valid entries replaced to make room */
+    };
+
+    /** Create a cache resolving through a network interface
+     *
+     *  @param net              Interface whose gethostbyname() is used
+     *  @param ttl_ms           Lifetime of a resolved name
+     *  @param negative_ttl_ms  Lifetime of a failed lookup, 0 to not cache failures
+     */
+    DnsCache(NetworkInterface *net, uint32_t ttl_ms = DNS_CACHE_TTL_MS,
+             uint32_t negative_ttl_ms = DNS_CACHE_NEGATIVE_TTL_MS);
+
+    /** Create a cache resolving through a resolver function
+     *
+     *  @param resolver         Called as resolver(host, address) on a miss
+     *  @param ttl_ms           Lifetime of a resolved name
+     *  @param negative_ttl_ms  Lifetime of a failed lookup, 0 to not cache failures
+     */
+    DnsCache(Resolver resolver, uint32_t ttl_ms = DNS_CACHE_TTL_MS,
+             uint32_t negative_ttl_ms = DNS_CACHE_NEGATIVE_TTL_MS);
+
+    /** Stop the periodic prefetch */
+    ~DnsCache();
+
+    /** Resolve a host name
+     *
+     *  @param host     Host name or IP address literal
+     *  @param address  Receives the address, port is left untouched
+     *  @return         0 on success, negative error code on failure
+     */
+    nsapi_error_t lookup(const char *host, SocketAddress *address);
+
+    /** Resolve a host name and connect a socket to it
+     *
+     *  @param socket   Open socket
+     *  @param host     Host name or IP address literal
+     *  @param port     Remote port
+     *  @return         0 on success, negative error code on failure
+     */
+    nsapi_error_t connect(TCPSocket *socket, const char *host, uint16_t port);
+
+    /** Resolve again the entries that were used close to their expiry
+     *
+     *  @return     Number of entries refreshed
+     */
+    int prefetch();
+
+    /** Call prefetch() periodically
+     *
+     *  @param queue        Queue whose thread runs the lookups
+     *  @param period_ms    Time between two prefetch() calls
+     *  @return             0 on success, NSAPI_ERROR_NO_MEMORY if the queue is full
+     */
+    nsapi_error_t start_prefetch(EventQueue *queue, int period_ms = DNS_CACHE_PREFETCH_PERIOD_MS);
+
+    /** Stop calling prefetch() */
+    void stop_prefetch();
+
+    /** Drop all entries */
+    void flush();
+
+    /** Get the lookup statistics */
+    const Stats &stats() const { return _stats; }
+
+    /** Clear the lookup statistics */
+    void reset_stats();
+
+    /** Print the lookup statistics */
+    void print_stats(const char *title) const;
+
+private:
+    struct Entry {
+        char host[DNS_CACHE_HOST_SIZE];
+        SocketAddress address;
+        nsapi_error_t result;
+        uint64_t expires_ms;
+        uint64_t used_ms;
+        bool refresh;
+    };
+
+    nsapi_error_t resolve(const char *host, SocketAddress *address);
+    void store(const char *host, const SocketAddress &address, nsapi_error_t result);
+    Entry *find(const char *host);
+    uint64_t now_ms();
+
+    NetworkInterface *_net;
+    Resolver _resolver;
+    uint32_t _ttl_ms;
+    uint32_t _negative_ttl_ms;
+    Mutex _mutex;
+    Timer _clock;
+    EventQueue *_prefetch_queue;
+    int _prefetch_id;
+    Stats _stats;
+    Entry _entries[DNS_CACHE_ENTRIES];
+};
+
+#endif
@@ -0,0 +1,270 @@
+/* DtlsClient
+ * Copyright (c) 2017 MXCHIP Information Tech. Co.,Ltd
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "DtlsClient.h"
+
+/* Fixed seed, runs with the same loss setting drop the same datagrams */
+#define DTLS_CLIENT_LOSS_SEED       0x2545F491u
+
+DtlsClient::DtlsClient(TlsEnvironment *tls, TlsSessionCache *sessions)
+    : _tls(tls), _sessions(sessions), _host(NULL), _connected(false), _resumed(false),
+      _cookie(false), _handshake_ms(0), _read_timeout_ms(DTLS_CLIENT_READ_TIMEOUT_MS),
+      _loss_percent(0), _loss_state(DTLS_CLIENT_LOSS_SEED), _int_ms(0), _fin_ms(0)
+{
+    memset(&_stats, 0, sizeof(_stats));
+    mbedtls_ssl_init(&_ssl);
+}
+
+DtlsClient::~DtlsClient()
+{
+    close();
+    mbedtls_ssl_free(&_ssl);
+}
+
+void DtlsClient::set_loss(uint32_t percent)
+{
+    _loss_percent = percent;
+    _loss_state = DTLS_CLIENT_LOSS_SEED;
+}
+
+bool DtlsClient::drop()
+{
+    if (_loss_percent == 0) {
+        return false;
+    }
+    /* xorshift32, enough to spread the drops */
+    _loss_state ^= _loss_state << 13;
+    _loss_state ^= _loss_state >> 17;
+    _loss_state ^= _loss_state << 5;
+    return _loss_state % 100 < _loss_percent;
+}
+
+int DtlsClient::bio_send(void *ctx, const unsigned char *buf, size_t len)
+{
+    DtlsClient *self = static_cast<DtlsClient *>(ctx);
+
+    if (self->drop()) {
+        /* Lost on the way, as far as anyone can tell */
+        self->_stats.dropped_sent++;
+        return len;
+    }
+
+    nsapi_size_or_error_t n = self->_socket.sendto(self->_peer, buf, len);
+    if (n == NSAPI_ERROR_WOULD_BLOCK) {
+        return MBEDTLS_ERR_SSL_WANT_WRITE;
+    }
+    if (n >= 0) {
+        self->_stats.datagrams_sent++;
+    }
+    return n;
+}
+
+int DtlsClient::bio_recv(void *ctx, unsigned char *buf, size_t len, uint32_t timeout)
+{
+    DtlsClient *self = static_cast<DtlsClient *>(ctx);
+    Timer waited;
+
+    /* During the handshake mbed TLS passes the retransmission timeout,
+     * afterwards the config's read timeout, 0 unless the application set one */
+    if (timeout == 0) {
+        timeout = self->_read_timeout_ms;
+    }
+
+    waited.start();
+    for (;;) {
+        uint32_t elapsed = waited.read_ms();
+        if (elapsed >= timeout) {
+            self->_stats.timeouts++;
+            return MBEDTLS_ERR_SSL_TIMEOUT;
+        }
+        self->_socket.set_timeout(timeout - elapsed);
+
+        SocketAddress from;
+        nsapi_size_or_error_t n = self->_socket.recvfrom(&from, buf, len);
+        if (n == NSAPI_ERROR_WOULD_BLOCK) {
+            self->_stats.timeouts++;
+            return MBEDTLS_ERR_SSL_TIMEOUT;
+        }
+        if (n < 0) {
+            return n;
+        }
+
+        /* Datagrams of anyone else are not part of this connection */
+        if (from != self->_peer) {
+            continue;
+        }
+        if (self->drop()) {
+            self->_stats.dropped_received++;
+            continue;
+        }
+        self->_stats.datagrams_received++;
+        return n;
+    }
+}
+
+void DtlsClient::timer_set(void *ctx, uint32_t int_ms, uint32_t fin_ms)
+{
+    DtlsClient *self = static_cast<DtlsClient *>(ctx);
+
+    self->_int_ms = int_ms;
+    self->_fin_ms = fin_ms;
+    if (fin_ms != 0) {
+        self->_timer.reset();
+        self->_timer.start();
+    }
+}
+
+int DtlsClient::timer_get(void *ctx)
+{
+    DtlsClient *self = static_cast<DtlsClient *>(ctx);
+
+    /* -1 cancelled, 0 running, 1 intermediate delay passed, 2 final delay passed */
+    if (self->_fin_ms == 0) {
+        return -1;
+    }
+    uint32_t elapsed = self->_timer.read_ms();
+    if (elapsed >= self->_fin_ms) {
+        return 2;
+    }
+    if (elapsed >= self->_int_ms) {
+        return 1;
+    }
+    return 0;
+}
+
+int DtlsClient::connect(NetworkInterface *net, const char *host, uint16_t port, DnsCache *dns)
+{
+    int ret;
+
+    close();
+    _host = host;
+    _resumed = false;
+    _cookie = false;
+
+    if (dns) {
+        ret = dns->lookup(host, &_peer);
+    } else {
+        ret = net->gethostbyname(host, &_peer);
+    }
+    if (ret != NSAPI_ERROR_OK) {
+        return ret;
+    }
+    _peer.set_port(port);
+
+    ret = _socket.open(net);
+    if (ret != NSAPI_ERROR_OK) {
+        return ret;
+    }
+
+    ret = _tls->setup(&_ssl, host);
+    if (ret != 0) {
+        _socket.close();
+        return ret;
+    }
+    TlsSessionCache::Offer offer;
+    bool offered = _sessions && _sessions->offer(&_ssl, host, port, &offer);
+    mbedtls_ssl_set_bio(&_ssl, this, bio_send, NULL, bio_recv);
+    mbedtls_ssl_set_timer_cb(&_ssl, this, timer_set, timer_get);
+
+    /* Step through the handshake to see a HelloVerifyRequest: the client
+     * goes back from ServerHello to a ClientHello carrying the cookie */
+    Timer timer;
+    timer.start();
+    while (_ssl.state != MBEDTLS_SSL_HANDSHAKE_OVER) {
+        int state = _ssl.state;
+        ret = mbedtls_ssl_handshake_step(&_ssl);
+        if (ret == MBEDTLS_ERR_SSL_WANT_READ || ret == MBEDTLS_ERR_SSL_WANT_WRITE) {
+            continue;
+        }
+        if (ret != 0) {
+            break;
+        }
+        if (state == MBEDTLS_SSL_SERVER_HELLO && _ssl.state == MBEDTLS_SSL_CLIENT_HELLO) {
+            _cookie = true;
+        }
+    }
+    _handshake_ms = timer.read_ms();
+
+    if (ret != 0) {
+        if (offered) {
+            /* Do not offer a session the server chokes on again */
+            _sessions->forget(host, port);
+        }
+        _socket.close();
+        mbedtls_ssl_free(&_ssl);
+        mbedtls_ssl_init(&_ssl);
+        return ret;
+    }
+
+    if (_sessions && _sessions->save(&_ssl, host, port, &offer) == 0) {
+        _resumed = offer.resumed;
+    }
+    _stats.handshakes++;
+    _stats.cookies += _cookie;
+    _stats.resumed += _resumed;
+    _connected = true;
+    return 0;
+}
+
+int DtlsClient::send(const void *data, size_t len)
+{
+    int ret;
+
+    if (!_connected) {
+        return MBEDTLS_ERR_SSL_BAD_INPUT_DATA;
+    }
+    do {
+        ret = mbedtls_ssl_write(&_ssl, (const unsigned char *) data, len);
+    } while (ret == MBEDTLS_ERR_SSL_WANT_READ || ret == MBEDTLS_ERR_SSL_WANT_WRITE);
+    return ret;
+}
+
+int DtlsClient::recv(void *data, size_t len, uint32_t timeout_ms)
+{
+    int ret;
+
+    if (!_connected) {
+        return MBEDTLS_ERR_SSL_BAD_INPUT_DATA;
+    }
+    _read_timeout_ms = timeout_ms;
+    do {
+        ret = mbedtls_ssl_read(&_ssl, (unsigned char *) data, len);
+    } while (ret == MBEDTLS_ERR_SSL_WANT_READ || ret == MBEDTLS_ERR_SSL_WANT_WRITE);
+    return ret;
+}
+
+void DtlsClient::close()
+{
+    if (_connected) {
+        mbedtls_ssl_close_notify(&_ssl);
+        _socket.close();
+        _connected = false;
+
+        /* A new connection needs a fresh context */
+        mbedtls_ssl_free(&_ssl);
+        mbedtls_ssl_init(&_ssl);
+    }
+}
+
+void DtlsClient::print_stats(const char *title) const
+{
+    printf("%s: %lu handshakes (%lu with cookie, %lu resumed), %lu/%lu datagrams sent/received, "
+           "%lu/%lu dropped, %lu timeouts\r\n",
+           title, (unsigned long)_stats.handshakes, (unsigned long)_stats.cookies,
+           (unsigned long)_stats.resumed, (unsigned long)_stats.datagrams_sent,
+           (unsigned long)_stats.datagrams_received, (unsigned long)_stats.dropped_sent,
+           (unsigned long)_stats.dropped_received, (unsigned long)_stats.timeouts);
+}
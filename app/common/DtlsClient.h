@@ -0,0 +1,151 @@
+/* DtlsClient
+ * Copyright (c) 2017 MXCHIP Information Tech. Co.,Ltd
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef DTLS_CLIENT_H
+#define DTLS_CLIENT_H
+
+#include "mbed.h"
+#include "UDPSocket.h"
+#include "DnsCache.h"
+#include "TlsEnvironment.h"
+#include "TlsSessionCache.h"
+
+/* Wait for a record in recv() when the config has no read timeout */
+#define DTLS_CLIENT_READ_TIMEOUT_MS 1000
+
+/** DtlsClient
+ *  DTLS 1.2 client over a UDPSocket.
+ *
+ *  Set up on a TlsEnvironment initialized with MBEDTLS_SSL_TRANSPORT_DATAGRAM.
+ *  Handshake retransmissions are driven by the mbed TLS timer callbacks,
+ *  backed by a Timer; the retransmission limits are the config's
+ *  handshake timeouts. A server that answers with HelloVerifyRequest gets
+ *  its cookie back, cookie_exchanged() tells afterwards.
+ *
+ *  Each send() is one datagram and a lost one is not sent again, so a loss
+ *  delays no later message. This mbed TLS has no Connection ID, so a client
+ *  whose address changed reconnects instead; with a TlsSessionCache that is
+ *  an abbreviated handshake of one round trip.
+ *
+ *  set_loss() drops datagrams in both directions before they reach the
+ *  socket or mbed TLS, to see the client under loss without a lossy link.
+ */
+class DtlsClient {
+public:
+    /** Datagram statistics, all counters since construction */
+    struct Stats {
+        uint32_t datagrams_sent;     /**< Passed to the socket */
+        uint32_t datagrams_received; /**< Passed to mbed TLS */
+        uint32_t dropped_sent;       /**< Dropped by the loss injection */
+        uint32_t dropped_received;   /**< Dropped by the loss injection */
+        uint32_t timeouts;           /**< Waits that ended without a datagram */
+        uint32_t handshakes;         /**< Completed handshakes */
+        uint32_t cookies;            /**< Handshakes that went through HelloVerifyRequest */
+        uint32_t resumed;            /**< Handshakes that resumed a cached session */
+    };
+
+    /** Create an unconnected client
+     *
+     *  @param tls      Initialized datagram TLS environment
+     *  @param sessions Sessions to resume, may be NULL
+     */
+    DtlsClient(TlsEnvironment *tls, TlsSessionCache *sessions = NULL);
+
+    /** Close the connection */
+    ~DtlsClient();
+
+    /** Resolve the server and run the handshake
+     *
+     *  @param net      Network interface to send through
+     *  @param host     Server host name, also sent as SNI; must stay valid
+     *  @param port     Server UDP port
+     *  @param dns      Cache the host name is resolved through, may be NULL
+     *  @return         0 on success, negative error code on failure
+     */
+    int connect(NetworkInterface *net, const char *host, uint16_t port, DnsCache *dns = NULL);
+
+    /** Send one message as one record
+     *
+     *  @param data     Message
+     *  @param len      Length, up to the record size
+     *  @return         Bytes sent, or negative mbed TLS error code
+     */
+    int send(const void *data, size_t len);
+
+    /** Receive one record
+     *
+     *  @param data         Buffer
+     *  @param len          Size of the buffer
+     *  @param timeout_ms   Wait at most this long, unless the config sets a read timeout
+     *  @return             Bytes received, MBEDTLS_ERR_SSL_TIMEOUT, or
+     *                      another negative mbed TLS error code
+     */
+    int recv(void *data, size_t len, uint32_t timeout_ms = DTLS_CLIENT_READ_TIMEOUT_MS);
+
+    /** Send close_notify and close the socket */
+    void close();
+
+    /** Drop datagrams at random
+     *
+     *  @param percent  Share of datagrams dropped each way, 0 for none
+     */
+    void set_loss(uint32_t percent);
+
+    bool connected() const { return _connected; }
+
+    /** Duration of the last handshake */
+    uint32_t handshake_ms() const { return _handshake_ms; }
+
+    /** Check if the last handshake resumed a cached session */
+    bool resumed() const { return _resumed; }
+
+    /** Check if the server asked for a cookie in the last handshake */
+    bool cookie_exchanged() const { return _cookie; }
+
+    /** Get the statistics */
+    const Stats &stats() const { return _stats; }
+
+    /** Print the statistics */
+    void print_stats(const char *title) const;
+
+private:
+    bool drop();
+
+    static int bio_send(void *ctx, const unsigned char *buf, size_t len);
+    static int bio_recv(void *ctx, unsigned char *buf, size_t len, uint32_t timeout);
+    static void timer_set(void *ctx, uint32_t int_ms, uint32_t fin_ms);
+    static int timer_get(void *ctx);
+
+    TlsEnvironment *_tls;
+    TlsSessionCache *_sessions;
+    UDPSocket _socket;
+    SocketAddress _peer;
+    mbedtls_ssl_context _ssl;
+    const char *_host;
+    bool _connected;
+    bool _resumed;
+    bool _cookie;
+    uint32_t _handshake_ms;
+    uint32_t _read_timeout_ms;
+    uint32_t _loss_percent;
+    uint32_t _loss_state;
+    Timer _timer;
+    uint32_t _int_ms;
+    uint32_t _fin_ms;
+    Stats _stats;
+};
+
+#endif
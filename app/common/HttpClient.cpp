@@ -0,0 +1,121 @@
+/* HttpClient
+ * Copyright (c) 2017 MXCHIP Information Tech. Co.,Ltd
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "HttpClient.h"
+
+HttpClient::HttpClient(NetworkInterface *net, const char *host, uint16_t port, DnsCache *dns)
+    : _net(net), _host(host), _port(port), _dns(dns), _writer(&_socket),
+      _connected(false), _connects(0), _responses(0), _buf_len(0), _buf_off(0)
+{
+}
+
+HttpClient::~HttpClient()
+{
+    close();
+}
+
+void HttpClient::close()
+{
+    if (_connected) {
+        _socket.close();
+        _connected = false;
+    }
+    /* Bytes of an unfinished response are useless on a new connection */
+    _buf_len = 0;
+    _buf_off = 0;
+}
+
+int HttpClient::ensure_connected()
+{
+    if (_connected) {
+        return NSAPI_ERROR_OK;
+    }
+
+    nsapi_error_t err = _socket.open(_net);
+    if (err != NSAPI_ERROR_OK) {
+        return err;
+    }
+
+    if (_dns) {
+        err = _dns->connect(&_socket, _host, _port);
+    } else {
+        err = _socket.connect(_host, _port);
+    }
+    if (err != NSAPI_ERROR_OK) {
+        _socket.close();
+        return err;
+    }
+
+    _connected = true;
+    _connects++;
+    return NSAPI_ERROR_OK;
+}
+
+int HttpClient::queue_request(const char *path)
+{
+    char request[HTTP_CLIENT_REQUEST_SIZE];
+
+    int len = snprintf(request, sizeof(request),
+                       "GET %s HTTP/1.1\r\nHost: %s\r\nConnection: keep-alive\r\n\r\n",
+                       path, _host);
+    if (len < 0 || len >= (int)sizeof(request)) {
+        return NSAPI_ERROR_PARAMETER;
+    }
+
+    return _writer.write(request, len);
+}
+
+int HttpClient::read_response(BodyHandler on_body)
+{
+    _parser.reset(on_body);
+
+    while (!_parser.done()) {
+        if (_buf_off == _buf_len) {
+            nsapi_size_or_error_t n = _socket.recv(_buf, sizeof(_buf));
+            if (n <= 0) {
+                /* Closed by the server, ends a read-until-close body */
+                _parser.finish();
+                if (_parser.done()) {
+                    break;
+                }
+                return n < 0 ? n : NSAPI_ERROR_NO_CONNECTION;
+            }
+            _buf_len = n;
+            _buf_off = 0;
+        }
+
+        _buf_off += _parser.feed(_buf + _buf_off, _buf_len - _buf_off);
+        if (_parser.error()) {
+            return NSAPI_ERROR_DEVICE_ERROR;
+        }
+    }
+
+    _responses++;
+    return _parser.status();
+}
+
+int HttpClient::get(const char *path, BodyHandler on_body)
+{
+    int status = 0;
+
+    int ret = get_pipelined(&path, 1, on_body, &status);
+    return ret < 0 ? ret : status;
+}
+
+int HttpClient::get_pipelined(const char *const *paths, int count, BodyHandler on_body, int *statuses)
+{
+    return HttpPipeline::get(this, HTTP_CLIENT_MAX_PIPELINE, paths, count, on_body, statuses);
+}
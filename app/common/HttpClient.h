@@ -0,0 +1,115 @@
+/* HttpClient
+ * Copyright (c) 2017 MXCHIP Information Tech. Co.,Ltd
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef HTTP_CLIENT_H
+#define HTTP_CLIENT_H
+
+#include "mbed.h"
+#include "TCPSocket.h"
+#include "TCPStreamWriter.h"
+#include "HttpResponseParser.h"
+#include "HttpPipeline.h"
+#include "DnsCache.h"
+
+/* Receive buffer, body bytes are passed on from here */
+#define HTTP_CLIENT_BUFFER_SIZE     512
+
+/* Longest request line plus headers */
+#define HTTP_CLIENT_REQUEST_SIZE    256
+
+/* Requests written before the first response is read */
+#define HTTP_CLIENT_MAX_PIPELINE    8
+
+/** HttpClient
+ *  HTTP/1.1 GET client that keeps one TCP connection to a server open.
+ *
+ *  Requests reuse the connection until the server closes it or answers
+ *  with "Connection: close"; the next request then reconnects. Responses
+ *  are parsed as they arrive and the body is streamed to a callback, so
+ *  the response size is not limited by RAM. Several requests can be
+ *  pipelined by an HttpPipeline; requests the server did not answer before
+ *  closing are sent again on a new connection.
+ */
+class HttpClient : private HttpPipeline::Transport {
+public:
+    typedef HttpResponseParser::BodyHandler BodyHandler;
+
+    /** Create a client for one server, no connection is made yet
+     *
+     *  @param net      Network interface to connect through
+     *  @param host     Host name, also sent in the Host header; must stay valid
+     *  @param port     Server port
+     *  @param dns      Cache the host name is resolved through, may be NULL
+     */
+    HttpClient(NetworkInterface *net, const char *host, uint16_t port = 80, DnsCache *dns = NULL);
+
+    /** Close the connection */
+    ~HttpClient();
+
+    /** GET one resource
+     *
+     *  @param path     Request path, e.g. "/"
+     *  @param on_body  Called with each piece of the body, may be empty
+     *  @return         HTTP status code, or negative error code
+     */
+    int get(const char *path, BodyHandler on_body = BodyHandler());
+
+    /** GET several resources, writing the requests before reading responses
+     *
+     *  @param paths    Request paths
+     *  @param count    Number of paths
+     *  @param on_body  Called with each piece of every body, in order
+     *  @param statuses Receives the status code of each response, may be NULL
+     *  @return         Number of responses received, or negative error code
+     */
+    int get_pipelined(const char *const *paths, int count, BodyHandler on_body = BodyHandler(),
+                      int *statuses = NULL);
+
+    /** Close the connection, the next request reconnects */
+    void close();
+
+    /** Body bytes of the last response */
+    uint32_t last_body_bytes() const { return _parser.body_bytes(); }
+
+    /** Connections opened so far */
+    uint32_t connects() const { return _connects; }
+
+    /** Responses received so far */
+    uint32_t responses() const { return _responses; }
+
+private:
+    int ensure_connected();
+    int queue_request(const char *path);
+    int flush_requests() { return NSAPI_ERROR_OK; }
+    int read_response(BodyHandler on_body);
+    bool keep_alive() const { return _parser.keep_alive(); }
+
+    NetworkInterface *_net;
+    const char *_host;
+    uint16_t _port;
+    DnsCache *_dns;
+    TCPSocket _socket;
+    TCPStreamWriter _writer;
+    HttpResponseParser _parser;
+    bool _connected;
+    uint32_t _connects;
+    uint32_t _responses;
+    nsapi_size_t _buf_len;
+    nsapi_size_t _buf_off;
+    char _buf[HTTP_CLIENT_BUFFER_SIZE];
+};
+
+#endif
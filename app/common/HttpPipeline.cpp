@@ -0,0 +1,85 @@
+/* HttpPipeline
+ * Copyright (c) 2017 MXCHIP Information Tech. Co.,Ltd
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "HttpPipeline.h"
+
+int HttpPipeline::get(Transport *transport, int max_window, const char *const *paths, int count,
+                      BodyHandler on_body, int *statuses)
+{
+    int done = 0;
+    bool retried = false;
+
+    while (done < count) {
+        int window = count - done;
+        if (window > max_window) {
+            window = max_window;
+        }
+
+        int err = transport->ensure_connected();
+        if (err != 0) {
+            return err;
+        }
+
+        int sent = 0;
+        for (; sent < window; sent++) {
+            err = transport->queue_request(paths[done + sent]);
+            if (err != 0) {
+                break;
+            }
+        }
+        if (err == 0) {
+            err = transport->flush_requests();
+        }
+        if (err != 0) {
+            /* Whatever was queued may not have left, send the window again */
+            sent = 0;
+        }
+
+        int progress = 0;
+        for (int i = 0; i < sent; i++) {
+            int status = transport->read_response(on_body);
+            if (status < 0) {
+                err = status;
+                break;
+            }
+            if (statuses) {
+                statuses[done] = status;
+            }
+            done++;
+            progress++;
+            if (!transport->keep_alive()) {
+                /* The rest of the window goes out again on a new connection */
+                transport->close();
+                break;
+            }
+        }
+
+        if (err != 0) {
+            transport->close();
+        }
+        if (err != 0 && progress == 0) {
+            /* A kept-alive connection may have been dropped while idle: retry once */
+            if (retried) {
+                return err;
+            }
+            retried = true;
+        } else if (progress > 0) {
+            retried = false;
+        }
+    }
+
+    return done;
+}
@@ -0,0 +1,89 @@
+/* HttpPipeline
+ * Copyright (c) 2017 MXCHIP Information Tech. Co.,Ltd
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef HTTP_PIPELINE_H
+#define HTTP_PIPELINE_H
+
+#include "mbed.h"
+#include "HttpResponseParser.h"
+
+/** HttpPipeline
+ *  Window and retry loop of the pipelining HTTP/1.1 clients.
+ *
+ *  Up to a window of GET requests is written before the first response is
+ *  read. Requests the server did not answer before closing, or that may
+ *  not have left when a write failed, are sent again on a new connection.
+ *  A connection kept alive may have been dropped by the server while
+ *  idle, so a window that makes no progress is retried once before the
+ *  error is returned. HttpClient runs it over TCP, HttpsClient over TLS.
+ */
+class HttpPipeline {
+public:
+    typedef HttpResponseParser::BodyHandler BodyHandler;
+
+    /** Connection to one server the requests are pipelined over */
+    class Transport {
+    public:
+        virtual ~Transport() {}
+
+        /** Connect unless a connection is open
+         *
+         *  @return         0 on success, negative error code on failure
+         */
+        virtual int ensure_connected() = 0;
+
+        /** Write a GET request, or queue it until flush_requests()
+         *
+         *  @param path     Request path
+         *  @return         0 on success, negative error code on failure
+         */
+        virtual int queue_request(const char *path) = 0;
+
+        /** Write the queued requests
+         *
+         *  @return         0 on success, negative error code on failure
+         */
+        virtual int flush_requests() = 0;
+
+        /** Read the next response
+         *
+         *  @param on_body  Called with each piece of the body, may be empty
+         *  @return         HTTP status code, or negative error code
+         */
+        virtual int read_response(BodyHandler on_body) = 0;
+
+        /** Whether the connection can carry another request after the last response */
+        virtual bool keep_alive() const = 0;
+
+        /** Close the connection, the next ensure_connected() reconnects */
+        virtual void close() = 0;
+    };
+
+    /** GET several resources over a transport
+     *
+     *  @param transport    Connection to the server
+     *  @param max_window   Requests written before the first response is read
+     *  @param paths        Request paths
+     *  @param count        Number of paths
+     *  @param on_body      Called with each piece of every body, in order
+     *  @param statuses     Receives the status code of each response, may be NULL
+     *  @return             Number of responses received, or negative error code
+     */
+    static int get(Transport *transport, int max_window, const char *const *paths, int count,
+                   BodyHandler on_body, int *statuses);
+};
+
+#endif
@@ -0,0 +1,189 @@
+/* HttpResponseParser
+ * Copyright (c) 2017 MXCHIP Information Tech. Co.,Ltd
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <ctype.h>
+
+#include "HttpResponseParser.h"
+
+HttpResponseParser::HttpResponseParser()
+{
+    reset();
+}
+
+void HttpResponseParser::reset(BodyHandler on_body)
+{
+    _state = STATUS_LINE;
+    _on_body = on_body;
+    _status = 0;
+    _keep_alive = true;
+    _chunked = false;
+    _content_length = -1;
+    _remaining = 0;
+    _body_bytes = 0;
+    _line_len = 0;
+}
+
+size_t HttpResponseParser::feed(const char *data, size_t len)
+{
+    size_t i = 0;
+
+    while (i < len && _state != DONE && _state != ERROR) {
+        switch (_state) {
+            case BODY_LENGTH:
+            case CHUNK_DATA: {
+                size_t n = len - i;
+                if (n > _remaining) {
+                    n = _remaining;
+                }
+                deliver(data + i, n);
+                _remaining -= n;
+                i += n;
+                if (_remaining == 0) {
+                    _state = (_state == BODY_LENGTH) ? DONE : CHUNK_DATA_END;
+                }
+                break;
+            }
+
+            case BODY_UNTIL_CLOSE:
+                deliver(data + i, len - i);
+                i = len;
+                break;
+
+            default: {
+                /* Line oriented states */
+                char c = data[i++];
+                if (c == '\n') {
+                    if (_line_len > 0 && _line[_line_len - 1] == '\r') {
+                        _line_len--;
+                    }
+                    _line[_line_len] = '\0';
+                    process_line();
+                    _line_len = 0;
+                } else if (_line_len < sizeof(_line) - 1) {
+                    _line[_line_len++] = c;
+                }
+                break;
+            }
+        }
+    }
+
+    return i;
+}
+
+void HttpResponseParser::finish()
+{
+    if (_state == BODY_UNTIL_CLOSE) {
+        _state = DONE;
+    } else if (_state != DONE) {
+        _state = ERROR;
+    }
+    _keep_alive = false;
+}
+
+void HttpResponseParser::deliver(const char *data, size_t len)
+{
+    _body_bytes += len;
+    if (_on_body) {
+        _on_body(data, len);
+    }
+}
+
+bool HttpResponseParser::header_is(const char *line, const char *name, const char **value)
+{
+    while (*name) {
+        if (tolower((unsigned char)*line++) != *name++) {
+            return false;
+        }
+    }
+    if (*line++ != ':') {
+        return false;
+    }
+    while (*line == ' ' || *line == '\t') {
+        line++;
+    }
+    *value = line;
+    return true;
+}
+
+void HttpResponseParser::process_line()
+{
+    const char *value;
+
+    switch (_state) {
+        case STATUS_LINE:
+            /* "HTTP/1.1 200 OK" */
+            if (strncmp(_line, "HTTP/1.", 7) != 0 || _line_len < 12) {
+                _state = ERROR;
+                return;
+            }
+            _keep_alive = (_line[7] != '0');
+            _status = atoi(_line + 9);
+            _state = HEADERS;
+            break;
+
+        case HEADERS:
+            if (_line_len == 0) {
+                headers_done();
+            } else if (header_is(_line, "content-length", &value)) {
+                _content_length = strtol(value, NULL, 10);
+            } else if (header_is(_line, "transfer-encoding", &value)) {
+                _chunked = (strstr(value, "chunked") != NULL);
+            } else if (header_is(_line, "connection", &value)) {
+                if (tolower((unsigned char)value[0]) == 'c') {
+                    _keep_alive = false;
+                } else if (tolower((unsigned char)value[0]) == 'k') {
+                    _keep_alive = true;
+                }
+            }
+            break;
+
+        case CHUNK_SIZE:
+            _remaining = strtoul(_line, NULL, 16);
+            _state = _remaining ? CHUNK_DATA : TRAILERS;
+            break;
+
+        case CHUNK_DATA_END:
+            _state = CHUNK_SIZE;
+            break;
+
+        case TRAILERS:
+            if (_line_len == 0) {
+                _state = DONE;
+            }
+            break;
+
+        default:
+            break;
+    }
+}
+
+void HttpResponseParser::headers_done()
+{
+    if (_status >= 100 && _status < 200) {
+        /* Interim response, the real one follows */
+        _state = STATUS_LINE;
+    } else if (_status == 204 || _status == 304) {
+        _state = DONE;
+    } else if (_chunked) {
+        _state = CHUNK_SIZE;
+    } else if (_content_length >= 0) {
+        _remaining = _content_length;
+        _state = _remaining ? BODY_LENGTH : DONE;
+    } else {
+        _state = BODY_UNTIL_CLOSE;
+        _keep_alive = false;
+    }
+}
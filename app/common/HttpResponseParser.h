@@ -0,0 +1,100 @@
+/* HttpResponseParser
+ * Copyright (c) 2017 MXCHIP Information Tech. Co.,Ltd
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef HTTP_RESPONSE_PARSER_H
+#define HTTP_RESPONSE_PARSER_H
+
+#include "mbed.h"
+
+/* Longest status or header line kept, longer lines are truncated */
+#define HTTP_PARSER_LINE_SIZE   128
+
+/** HttpResponseParser
+ *  Incremental HTTP/1.1 response parser.
+ *
+ *  Bytes are fed as they arrive from any transport. Only one header line
+ *  is buffered at a time; body bytes are handed to the body callback
+ *  straight from the caller's buffer, for Content-Length, chunked and
+ *  read-until-close bodies alike. feed() stops at the end of a response,
+ *  so bytes of a following pipelined response stay with the caller.
+ */
+class HttpResponseParser {
+public:
+    typedef Callback<void(const char *, size_t)> BodyHandler;
+
+    HttpResponseParser();
+
+    /** Prepare for the next response
+     *
+     *  @param on_body  Called with each piece of the body, may be empty
+     */
+    void reset(BodyHandler on_body = BodyHandler());
+
+    /** Parse received bytes
+     *
+     *  @param data     Received bytes
+     *  @param len      Number of bytes
+     *  @return         Bytes consumed, less than len once the response is complete
+     */
+    size_t feed(const char *data, size_t len);
+
+    /** Tell the parser the connection was closed */
+    void finish();
+
+    bool done() const { return _state == DONE; }
+    bool error() const { return _state == ERROR; }
+
+    /** Status code, 0 until the status line is parsed */
+    int status() const { return _status; }
+
+    /** Whether the connection can carry another request afterwards */
+    bool keep_alive() const { return _keep_alive; }
+
+    /** Body bytes delivered so far */
+    uint32_t body_bytes() const { return _body_bytes; }
+
+private:
+    enum State {
+        STATUS_LINE,
+        HEADERS,
+        BODY_LENGTH,
+        BODY_UNTIL_CLOSE,
+        CHUNK_SIZE,
+        CHUNK_DATA,
+        CHUNK_DATA_END,
+        TRAILERS,
+        DONE,
+        ERROR
+    };
+
+    void process_line();
+    void headers_done();
+    void deliver(const char *data, size_t len);
+    static bool header_is(const char *line, const char *name, const char **value);
+
+    State _state;
+    BodyHandler _on_body;
+    int _status;
+    bool _keep_alive;
+    bool _chunked;
+    int32_t _content_length;
+    uint32_t _remaining;
+    uint32_t _body_bytes;
+    size_t _line_len;
+    char _line[HTTP_PARSER_LINE_SIZE];
+};
+
+#endif
@@ -0,0 +1,159 @@
+/* HttpsClient
+ * Copyright (c) 2017 MXCHIP Information Tech. Co.,Ltd
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "HttpsClient.h"
+#include "TlsSocketBio.h"
+
+HttpsClient::HttpsClient(NetworkInterface *net, TlsEnvironment *tls, const char *host, uint16_t port,
+                         DnsCache *dns, TlsSessionCache *sessions)
+    : _net(net), _tls(tls), _host(host), _port(port), _dns(dns), _sessions(sessions),
+      _connected(false), _connects(0), _resumed(0), _responses(0), _request_len(0)
+{
+    mbedtls_ssl_init(&_ssl);
+}
+
+HttpsClient::~HttpsClient()
+{
+    close();
+    mbedtls_ssl_free(&_ssl);
+}
+
+void HttpsClient::close()
+{
+    if (_connected) {
+        mbedtls_ssl_close_notify(&_ssl);
+        _socket.close();
+        _connected = false;
+
+        /* A new connection needs a fresh context */
+        mbedtls_ssl_free(&_ssl);
+        mbedtls_ssl_init(&_ssl);
+    }
+    /* Bytes of an unfinished response are useless on a new connection */
+    _reader.discard();
+    _request_len = 0;
+}
+
+int HttpsClient::ensure_connected()
+{
+    if (_connected) {
+        return 0;
+    }
+
+    int ret = _tls->setup(&_ssl, _host);
+    if (ret != 0) {
+        return ret;
+    }
+    TlsSessionCache::Offer offer;
+    bool offered = _sessions && _sessions->offer(&_ssl, _host, _port, &offer);
+    mbedtls_ssl_set_bio(&_ssl, &_socket, TlsSocketBio::send, TlsSocketBio::recv, NULL);
+
+    ret = _socket.open(_net);
+    if (ret == NSAPI_ERROR_OK) {
+        if (_dns) {
+            ret = _dns->connect(&_socket, _host, _port);
+        } else {
+            ret = _socket.connect(_host, _port);
+        }
+    }
+
+    if (ret == NSAPI_ERROR_OK) {
+        do {
+            ret = mbedtls_ssl_handshake(&_ssl);
+        } while (ret == MBEDTLS_ERR_SSL_WANT_READ || ret == MBEDTLS_ERR_SSL_WANT_WRITE);
+        if (ret != 0 && offered) {
+            /* Do not offer a session the server chokes on again */
+            _sessions->forget(_host, _port);
+        }
+    }
+
+    if (ret != 0) {
+        _socket.close();
+        mbedtls_ssl_free(&_ssl);
+        mbedtls_ssl_init(&_ssl);
+        return ret;
+    }
+
+    if (_sessions && _sessions->save(&_ssl, _host, _port, &offer) == 0 && offer.resumed) {
+        _resumed++;
+    }
+    _connected = true;
+    _connects++;
+    return 0;
+}
+
+int HttpsClient::flush_requests()
+{
+    /* mbedtls_ssl_write may take less than asked, send the rest too */
+    for (size_t sent = 0; sent < _request_len; ) {
+        int ret = mbedtls_ssl_write(&_ssl, (const unsigned char *) _request + sent, _request_len - sent);
+        if (ret == MBEDTLS_ERR_SSL_WANT_READ || ret == MBEDTLS_ERR_SSL_WANT_WRITE) {
+            continue;
+        }
+        if (ret < 0) {
+            _request_len = 0;
+            return ret;
+        }
+        sent += ret;
+    }
+
+    _request_len = 0;
+    return 0;
+}
+
+int HttpsClient::queue_request(const char *path)
+{
+    char request[HTTPS_CLIENT_REQUEST_SIZE];
+
+    int len = snprintf(request, sizeof(request),
+                       "GET %s HTTP/1.1\r\nHost: %s\r\nConnection: keep-alive\r\n\r\n",
+                       path, _host);
+    if (len < 0 || len >= (int)sizeof(request)) {
+        return NSAPI_ERROR_PARAMETER;
+    }
+
+    if (_request_len + len > sizeof(_request)) {
+        int ret = flush_requests();
+        if (ret != 0) {
+            return ret;
+        }
+    }
+    memcpy(_request + _request_len, request, len);
+    _request_len += len;
+    return 0;
+}
+
+int HttpsClient::get(const char *path, BodyHandler on_body)
+{
+    int status = 0;
+
+    int ret = get_pipelined(&path, 1, on_body, &status);
+    return ret < 0 ? ret : status;
+}
+
+int HttpsClient::read_response(BodyHandler on_body)
+{
+    int status = _reader.read(&_ssl, on_body);
+    if (status >= 0) {
+        _responses++;
+    }
+    return status;
+}
+
+int HttpsClient::get_pipelined(const char *const *paths, int count, BodyHandler on_body, int *statuses)
+{
+    return HttpPipeline::get(this, HTTPS_CLIENT_MAX_PIPELINE, paths, count, on_body, statuses);
+}
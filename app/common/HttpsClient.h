@@ -0,0 +1,122 @@
+/* HttpsClient
+ * Copyright (c) 2017 MXCHIP Information Tech. Co.,Ltd
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef HTTPS_CLIENT_H
+#define HTTPS_CLIENT_H
+
+#include "mbed.h"
+#include "TCPSocket.h"
+#include "DnsCache.h"
+#include "TlsEnvironment.h"
+#include "TlsSessionCache.h"
+#include "HttpsResponseReader.h"
+#include "HttpPipeline.h"
+
+/* Requests are collected here and written as one TLS record */
+#define HTTPS_CLIENT_REQUEST_SIZE   512
+
+/* Requests written before the first response is read */
+#define HTTPS_CLIENT_MAX_PIPELINE   8
+
+/** HttpsClient
+ *  HTTP/1.1 GET client that keeps one TLS connection to a server open.
+ *
+ *  The same as HttpClient over TLS: requests reuse the connection and its
+ *  TLS session until the server closes it or answers with
+ *  "Connection: close", then the next request reconnects, resuming the
+ *  session when a TlsSessionCache is given. Requests pipelined by an
+ *  HttpPipeline are packed into as few records as fit
+ *  HTTPS_CLIENT_REQUEST_SIZE. Bodies are streamed to a callback by an
+ *  HttpsResponseReader.
+ */
+class HttpsClient : private HttpPipeline::Transport {
+public:
+    typedef HttpsResponseReader::BodyHandler BodyHandler;
+
+    /** Create a client for one server, no connection is made yet
+     *
+     *  @param net      Network interface to connect through
+     *  @param tls      Initialized TLS environment connections are set up on
+     *  @param host     Host name, also sent as SNI and in the Host header; must stay valid
+     *  @param port     Server port
+     *  @param dns      Cache the host name is resolved through, may be NULL
+     *  @param sessions Sessions to resume on reconnect, may be NULL
+     */
+    HttpsClient(NetworkInterface *net, TlsEnvironment *tls, const char *host, uint16_t port = 443,
+                DnsCache *dns = NULL, TlsSessionCache *sessions = NULL);
+
+    /** Close the connection */
+    ~HttpsClient();
+
+    /** GET one resource
+     *
+     *  @param path     Request path, e.g. "/"
+     *  @param on_body  Called with each piece of the body, may be empty
+     *  @return         HTTP status code, or negative error code
+     */
+    int get(const char *path, BodyHandler on_body = BodyHandler());
+
+    /** GET several resources, writing the requests before reading responses
+     *
+     *  @param paths    Request paths
+     *  @param count    Number of paths
+     *  @param on_body  Called with each piece of every body, in order
+     *  @param statuses Receives the status code of each response, may be NULL
+     *  @return         Number of responses received, or negative error code
+     */
+    int get_pipelined(const char *const *paths, int count, BodyHandler on_body = BodyHandler(),
+                      int *statuses = NULL);
+
+    /** Send close_notify and close the connection, the next request reconnects */
+    void close();
+
+    /** Reader of the responses, holds the download statistics */
+    const HttpsResponseReader &reader() const { return _reader; }
+
+    /** Connections opened so far */
+    uint32_t connects() const { return _connects; }
+
+    /** Handshakes that resumed a cached session */
+    uint32_t resumed() const { return _resumed; }
+
+    /** Responses received so far */
+    uint32_t responses() const { return _responses; }
+
+private:
+    int ensure_connected();
+    int queue_request(const char *path);
+    int flush_requests();
+    int read_response(BodyHandler on_body);
+    bool keep_alive() const { return _reader.keep_alive(); }
+
+    NetworkInterface *_net;
+    TlsEnvironment *_tls;
+    const char *_host;
+    uint16_t _port;
+    DnsCache *_dns;
+    TlsSessionCache *_sessions;
+    TCPSocket _socket;
+    mbedtls_ssl_context _ssl;
+    HttpsResponseReader _reader;
+    bool _connected;
+    uint32_t _connects;
+    uint32_t _resumed;
+    uint32_t _responses;
+    size_t _request_len;
+    char _request[HTTPS_CLIENT_REQUEST_SIZE];
+};
+
+#endif
@@ -0,0 +1,97 @@
+/* HttpsResponseReader
+ * Copyright (c) 2017 MXCHIP Information Tech. Co.,Ltd
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "HttpsResponseReader.h"
+
+HttpsResponseReader::HttpsResponseReader()
+    : _reading(false), _started(false), _last_us(0), _buf_len(0), _buf_off(0)
+{
+    memset(&_stats, 0, sizeof(_stats));
+}
+
+void HttpsResponseReader::discard()
+{
+    _buf_len = 0;
+    _buf_off = 0;
+    _reading = false;
+}
+
+int HttpsResponseReader::read(mbedtls_ssl_context *ssl, BodyHandler on_body)
+{
+    if (!_reading) {
+        _parser.reset(on_body);
+        _timer.stop();
+        _timer.reset();
+        _started = false;
+        _last_us = 0;
+        _reading = true;
+    }
+
+    while (!_parser.done()) {
+        if (_buf_off == _buf_len) {
+            int n = mbedtls_ssl_read(ssl, (unsigned char *) _buf, sizeof(_buf));
+            if (n == MBEDTLS_ERR_SSL_WANT_READ || n == MBEDTLS_ERR_SSL_WANT_WRITE) {
+                /* Non-blocking socket, the next call goes on from here */
+                return NSAPI_ERROR_WOULD_BLOCK;
+            }
+            if (n == 0 || n == MBEDTLS_ERR_SSL_PEER_CLOSE_NOTIFY) {
+                /* Closed by the server, ends a read-until-close body */
+                _parser.finish();
+                if (_parser.done()) {
+                    break;
+                }
+                _reading = false;
+                return NSAPI_ERROR_NO_CONNECTION;
+            }
+            if (n < 0) {
+                _reading = false;
+                return n;
+            }
+            _buf_len = n;
+            _buf_off = 0;
+            _stats.records++;
+        }
+
+        /* Clocked from the first byte, the server's think time is not download time */
+        if (!_started) {
+            _timer.start();
+            _started = true;
+        }
+        _buf_off += _parser.feed(_buf + _buf_off, _buf_len - _buf_off);
+        if (_parser.error()) {
+            _reading = false;
+            return NSAPI_ERROR_DEVICE_ERROR;
+        }
+    }
+
+    _reading = false;
+    _timer.stop();
+    _last_us = _timer.read_us();
+    _stats.read_us += _last_us;
+    _stats.body_bytes += _parser.body_bytes();
+    _stats.responses++;
+    return _parser.status();
+}
+
+void HttpsResponseReader::print_stats(const char *title) const
+{
+    /* bytes per ms is KB/s near enough */
+    uint32_t ms = _stats.read_us / 1000;
+    printf("%s: %lu responses, %lu body bytes in %lu records, %lu ms, %lu KB/s\r\n",
+           title, (unsigned long)_stats.responses, (unsigned long)_stats.body_bytes,
+           (unsigned long)_stats.records, (unsigned long)ms,
+           (unsigned long)(ms ? _stats.body_bytes / ms : 0));
+}
@@ -0,0 +1,97 @@
+/* HttpsResponseReader
+ * Copyright (c) 2017 MXCHIP Information Tech. Co.,Ltd
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef HTTPS_RESPONSE_READER_H
+#define HTTPS_RESPONSE_READER_H
+
+#include "mbed.h"
+#include "HttpResponseParser.h"
+#include "mbedtls/ssl.h"
+
+/* Decrypted bytes read per mbedtls_ssl_read. A call never returns more than
+ * one record, so records up to this size reach the body callback whole */
+#define HTTPS_READER_BUFFER_SIZE    2048
+
+/** HttpsResponseReader
+ *  Reads HTTP/1.1 responses from an established TLS connection.
+ *
+ *  Headers are parsed as records arrive and the body is streamed to a
+ *  callback straight from the receive buffer, with Content-Length, chunked
+ *  and read-until-close bodies, so a download is not limited by RAM. Bytes
+ *  after the end of a response are kept for the next read() on the same
+ *  connection. The time from the first to the last byte of each response
+ *  is measured to report download throughput.
+ */
+class HttpsResponseReader {
+public:
+    typedef HttpResponseParser::BodyHandler BodyHandler;
+
+    /** Download statistics, over all responses */
+    struct Stats {
+        uint32_t responses;     /**< Complete responses */
+        uint32_t body_bytes;    /**< Body bytes delivered */
+        uint32_t records;       /**< Successful mbedtls_ssl_read calls */
+        uint32_t read_us;       /**< First to last byte, summed over responses */
+    };
+
+    HttpsResponseReader();
+
+    /** Read one response
+     *
+     *  On a non-blocking connection a read that has to wait returns
+     *  NSAPI_ERROR_WOULD_BLOCK; call again when the socket is readable to
+     *  continue the same response, the first call's on_body is kept.
+     *
+     *  @param ssl      Connection the request was written to, blocking or not
+     *  @param on_body  Called with each piece of the body, may be empty
+     *  @return         HTTP status code, negative mbed TLS error code,
+     *                  NSAPI_ERROR_WOULD_BLOCK if the response is not complete yet,
+     *                  NSAPI_ERROR_NO_CONNECTION if the server closed early or
+     *                  NSAPI_ERROR_DEVICE_ERROR for a malformed response
+     */
+    int read(mbedtls_ssl_context *ssl, BodyHandler on_body = BodyHandler());
+
+    /** Drop buffered bytes and a partly read response, when the connection is closed */
+    void discard();
+
+    /** Whether the connection can carry another request after the last response */
+    bool keep_alive() const { return _parser.keep_alive(); }
+
+    /** Body bytes of the last response */
+    uint32_t body_bytes() const { return _parser.body_bytes(); }
+
+    /** First to last byte of the last response */
+    uint32_t last_us() const { return _last_us; }
+
+    /** Get the statistics */
+    const Stats &stats() const { return _stats; }
+
+    /** Print the statistics */
+    void print_stats(const char *title) const;
+
+private:
+    HttpResponseParser _parser;
+    Stats _stats;
+    Timer _timer;
+    bool _reading;              /**< A response was started and is not complete */
+    bool _started;              /**< Its first byte arrived */
+    uint32_t _last_us;
+    size_t _buf_len;
+    size_t _buf_off;
+    char _buf[HTTPS_READER_BUFFER_SIZE];
+};
+
+#endif
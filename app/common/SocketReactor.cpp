@@ -0,0 +1,127 @@
+/* SocketReactor
+ * Copyright (c) 2017 MXCHIP Information Tech. Co.,Ltd
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "SocketReactor.h"
+
+SocketReactor::SocketReactor(EventQueue *queue)
+    : _queue(queue), _count(0)
+{
+}
+
+SocketReactor::~SocketReactor()
+{
+    for (int i = 0; i < SOCKET_REACTOR_MAX_SOCKETS; i++) {
+        if (_entries[i].socket) {
+            remove(_entries[i].socket);
+        }
+    }
+}
+
+void SocketReactor::Entry::on_sigio()
+{
+    /* Runs in the stack's context: only post, and only once per burst of events */
+    if (!pending) {
+        pending = true;
+        /* Queue full: the next event posts again */
+        if (reactor->_queue->call(this, &Entry::dispatch) == 0) {
+            pending = false;
+        }
+    }
+}
+
+void SocketReactor::Entry::dispatch()
+{
+    pending = false;
+
+    /* The handler may remove (and reuse) this entry, so copy what we need first */
+    Socket *watched = socket;
+    Handler on_write = on_writable;
+
+    if (watched && on_readable) {
+        on_readable();
+    }
+    if (watched && socket == watched && on_write) {
+        on_write();
+    }
+}
+
+nsapi_error_t SocketReactor::add(Socket *socket, Handler on_readable, Handler on_writable)
+{
+    for (int i = 0; i < SOCKET_REACTOR_MAX_SOCKETS; i++) {
+        Entry *e = &_entries[i];
+        if (e->socket) {
+            continue;
+        }
+
+        e->socket = socket;
+        e->reactor = this;
+        e->on_readable = on_readable;
+        e->on_writable = on_writable;
+        e->pending = false;
+        _count++;
+
+        socket->set_blocking(false);
+        socket->sigio(callback(e, &Entry::on_sigio));
+
+        /* Data may already be waiting, look once without an event */
+        e->on_sigio();
+        return NSAPI_ERROR_OK;
+    }
+
+    return NSAPI_ERROR_NO_MEMORY;
+}
+
+void SocketReactor::remove(Socket *socket)
+{
+    for (int i = 0; i < SOCKET_REACTOR_MAX_SOCKETS; i++) {
+        Entry *e = &_entries[i];
+        if (e->socket != socket) {
+            continue;
+        }
+
+        socket->sigio(NULL);
+        e->socket = NULL;
+        e->on_readable = Handler();
+        e->on_writable = Handler();
+        _count--;
+        return;
+    }
+}
+
+void SocketReactor::notify(Socket *socket)
+{
+    for (int i = 0; i < SOCKET_REACTOR_MAX_SOCKETS; i++) {
+        if (_entries[i].socket == socket) {
+            _entries[i].on_sigio();
+            return;
+        }
+    }
+}
+
+int SocketReactor::add_timer(int ms, Handler handler)
+{
+    return _queue->call_every(ms, handler);
+}
+
+void SocketReactor::cancel_timer(int id)
+{
+    _queue->cancel(id);
+}
+
+void SocketReactor::run()
+{
+    _queue->dispatch_forever();
+}
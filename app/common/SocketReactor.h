@@ -0,0 +1,108 @@
+/* SocketReactor
+ * Copyright (c) 2017 MXCHIP Information Tech. Co.,Ltd
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef SOCKET_REACTOR_H
+#define SOCKET_REACTOR_H
+
+#include "mbed.h"
+#include "EventQueue.h"
+
+/* Maximum number of sockets registered at once */
+#define SOCKET_REACTOR_MAX_SOCKETS  10
+
+/** SocketReactor
+ *  Serves many sockets from the thread that dispatches one EventQueue.
+ *
+ *  Registered sockets are switched to non-blocking mode. Their sigio
+ *  event, raised from the network stack's context, only posts a dispatch
+ *  to the queue; the read and write handlers then run on the queue's
+ *  thread. sigio does not tell readable from writable, so both handlers
+ *  run and must stop on NSAPI_ERROR_WOULD_BLOCK.
+ *
+ *  Timers are plain EventQueue events on the same queue.
+ */
+class SocketReactor {
+public:
+    typedef Callback<void()> Handler;
+
+    /** Create a reactor on an event queue
+     *
+     *  @param queue    Queue the handlers are dispatched from
+     */
+    SocketReactor(EventQueue *queue);
+
+    /** Stop watching all sockets */
+    ~SocketReactor();
+
+    /** Watch a socket
+     *
+     *  @param socket       Open socket
+     *  @param on_readable  Called when data or a connection may be waiting
+     *  @param on_writable  Called when the socket may accept data
+     *  @return             0 on success, NSAPI_ERROR_NO_MEMORY if the table is full
+     */
+    nsapi_error_t add(Socket *socket, Handler on_readable, Handler on_writable = Handler());
+
+    /** Stop watching a socket, call it before the socket is closed
+     *
+     *  @param socket   Socket passed to add()
+     */
+    void remove(Socket *socket);
+
+    /** Queue a dispatch for a socket as if its sigio had fired
+     *
+     *  For handlers that stop before NSAPI_ERROR_WOULD_BLOCK to let other
+     *  sockets run; without it no new sigio would arrive for pending data.
+     *
+     *  @param socket   Socket passed to add()
+     */
+    void notify(Socket *socket);
+
+    /** Call a handler every ms milliseconds
+     *
+     *  @return     Timer id for cancel_timer()
+     */
+    int add_timer(int ms, Handler handler);
+
+    /** Cancel a timer created with add_timer() */
+    void cancel_timer(int id);
+
+    /** Number of sockets watched */
+    int count() const { return _count; }
+
+    /** Dispatch events until break_dispatch() is called on the queue */
+    void run();
+
+private:
+    class Entry {
+    public:
+        Entry() : socket(NULL), reactor(NULL), pending(false) {}
+        void on_sigio();
+        void dispatch();
+
+        Socket *socket;
+        SocketReactor *reactor;
+        Handler on_readable;
+        Handler on_writable;
+        volatile bool pending;
+    };
+
+    EventQueue *_queue;
+    Entry _entries[SOCKET_REACTOR_MAX_SOCKETS];
+    int _count;
+};
+
+#endif
@@ -0,0 +1,150 @@
+/* TCPStreamWriter
+ * Copyright (c) 2017 MXCHIP Information Tech. Co.,Ltd
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "TCPStreamWriter.h"
+
+TCPStreamWriter::TCPStreamWriter(TCPSocket *socket, bool non_blocking, int timeout_ms)
+    : _socket(socket), _non_blocking(non_blocking), _timeout_ms(timeout_ms), _sigio(0), _stage_len(0)
+{
+    reset_stats();
+
+    if (_non_blocking) {
+        _socket->set_blocking(false);
+        _socket->sigio(callback(this, &TCPStreamWriter::on_sigio));
+    }
+}
+
+TCPStreamWriter::~TCPStreamWriter()
+{
+    if (_non_blocking) {
+        _socket->sigio(NULL);
+    }
+}
+
+void TCPStreamWriter::reset_stats()
+{
+    memset(&_stats, 0, sizeof(_stats));
+}
+
+void TCPStreamWriter::print_stats(const char *title) const
+{
+    printf("%s: %lu bytes, %lu writes, %lu short writes, %lu stalls, %lu errors\r\n", title,
+           (unsigned long)_stats.bytes, (unsigned long)_stats.writes, (unsigned long)_stats.short_writes,
+           (unsigned long)_stats.stalls, (unsigned long)_stats.errors);
+}
+
+void TCPStreamWriter::on_sigio()
+{
+    _sigio.release();
+}
+
+void TCPStreamWriter::wait_for_room(int backoff_ms)
+{
+    if (_non_blocking) {
+        /* sigio fires when the stack frees send buffer, the backoff bounds a lost event */
+        _sigio.wait(backoff_ms);
+    } else {
+        Thread::wait(backoff_ms);
+    }
+}
+
+nsapi_error_t TCPStreamWriter::send_all(const uint8_t *data, nsapi_size_t size)
+{
+    int backoff_ms = TCP_STREAM_WRITER_BACKOFF_MS;
+    int stalled_ms = 0;
+
+    while (size > 0) {
+        nsapi_size_or_error_t sent = _socket->send(data, size);
+        _stats.writes++;
+
+        if (sent > 0) {
+            if ((nsapi_size_t)sent < size) {
+                _stats.short_writes++;
+            }
+            _stats.bytes += sent;
+            data += sent;
+            size -= sent;
+            backoff_ms = TCP_STREAM_WRITER_BACKOFF_MS;
+            stalled_ms = 0;
+            continue;
+        }
+
+        if (sent != NSAPI_ERROR_WOULD_BLOCK && sent != NSAPI_ERROR_NO_MEMORY && sent != 0) {
+            _stats.errors++;
+            return sent;
+        }
+
+        /* No room in the stack, back off and retry */
+        _stats.stalls++;
+        if (_timeout_ms >= 0 && stalled_ms >= _timeout_ms) {
+            _stats.errors++;
+            return NSAPI_ERROR_WOULD_BLOCK;
+        }
+        wait_for_room(backoff_ms);
+        stalled_ms += backoff_ms;
+        if (backoff_ms < TCP_STREAM_WRITER_BACKOFF_MAX_MS) {
+            backoff_ms *= 2;
+        }
+    }
+
+    return NSAPI_ERROR_OK;
+}
+
+nsapi_error_t TCPStreamWriter::write(const void *data, nsapi_size_t size)
+{
+    nsapi_error_t err = flush_stage();
+    if (err != NSAPI_ERROR_OK) {
+        return err;
+    }
+
+    return send_all(static_cast<const uint8_t *>(data), size);
+}
+
+nsapi_error_t TCPStreamWriter::flush_stage()
+{
+    if (_stage_len == 0) {
+        return NSAPI_ERROR_OK;
+    }
+
+    nsapi_error_t err = send_all(_stage, _stage_len);
+    _stage_len = 0;
+    return err;
+}
+
+nsapi_error_t TCPStreamWriter::writev(const Buffer *bufs, int count)
+{
+    nsapi_error_t err;
+
+    for (int i = 0; i < count; i++) {
+        if (bufs[i].size < TCP_STREAM_WRITER_STAGE_SIZE) {
+            if (_stage_len + bufs[i].size > TCP_STREAM_WRITER_STAGE_SIZE) {
+                err = flush_stage();
+                if (err != NSAPI_ERROR_OK) {
+                    return err;
+                }
+            }
+            memcpy(_stage + _stage_len, bufs[i].data, bufs[i].size);
+            _stage_len += bufs[i].size;
+        } else {
+            err = write(bufs[i].data, bufs[i].size);
+            if (err != NSAPI_ERROR_OK) {
+                return err;
+            }
+        }
+    }
+
+    return flush_stage();
+}
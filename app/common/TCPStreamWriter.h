@@ -0,0 +1,112 @@
+/* TCPStreamWriter
+ * Copyright (c) 2017 MXCHIP Information Tech. Co.,Ltd
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef TCP_STREAM_WRITER_H
+#define TCP_STREAM_WRITER_H
+
+#include "mbed.h"
+#include "TCPSocket.h"
+
+/* Small gather pieces are coalesced into this many bytes before they are sent */
+#define TCP_STREAM_WRITER_STAGE_SIZE    256
+
+/* Backoff after NSAPI_ERROR_WOULD_BLOCK or NSAPI_ERROR_NO_MEMORY, doubled up to the max */
+#define TCP_STREAM_WRITER_BACKOFF_MS     1
+#define TCP_STREAM_WRITER_BACKOFF_MAX_MS 64
+
+/** TCPStreamWriter
+ *  Pushes whole buffers through a TCPSocket.
+ *
+ *  TCPSocket::send() may accept only part of a buffer, report that it
+ *  would block, or fail. The writer loops over partial writes, waits with
+ *  an exponential backoff while the stack has no room and returns any
+ *  other error to the caller, so a caller never sees a partial write.
+ *
+ *  In non-blocking mode the socket is switched to non-blocking and the
+ *  writer waits for the socket's sigio event instead of polling.
+ */
+class TCPStreamWriter {
+public:
+    /** A piece of a gather write */
+    struct Buffer {
+        const void *data;
+        nsapi_size_t size;
+    };
+
+    /** Write statistics, all counters since construction or reset_stats() */
+    struct Stats {
+        uint32_t bytes;        /**< Bytes accepted by the socket */
+        uint32_t writes;       /**< Calls to TCPSocket::send() */
+        uint32_t short_writes; /**< send() calls that accepted less than offered */
+        uint32_t stalls;       /**< send() calls that reported no room */
+        uint32_t errors;       /**< Writes that ended with an error */
+    };
+
+    /** Create a writer on a connected socket
+     *
+     *  @param socket       Connected socket, must outlive the writer
+     *  @param non_blocking Drive the socket with sigio instead of blocking calls
+     *  @param timeout_ms   Give up after this long without progress, -1 for never
+     */
+    TCPStreamWriter(TCPSocket *socket, bool non_blocking = false, int timeout_ms = -1);
+
+    /** Detach from the socket's sigio */
+    ~TCPStreamWriter();
+
+    /** Write a whole buffer
+     *
+     *  @param data     Buffer to send
+     *  @param size     Number of bytes to send
+     *  @return         0 on success, negative error code on failure
+     */
+    nsapi_error_t write(const void *data, nsapi_size_t size);
+
+    /** Write several buffers as one stream
+     *
+     *  Pieces shorter than TCP_STREAM_WRITER_STAGE_SIZE are coalesced so a
+     *  header and a payload do not go out as separate tiny segments.
+     *
+     *  @param bufs     Buffers to send, in order
+     *  @param count    Number of buffers
+     *  @return         0 on success, negative error code on failure
+     */
+    nsapi_error_t writev(const Buffer *bufs, int count);
+
+    /** Get the write statistics */
+    const Stats &stats() const { return _stats; }
+
+    /** Clear the write statistics */
+    void reset_stats();
+
+    /** Print the write statistics */
+    void print_stats(const char *title) const;
+
+private:
+    nsapi_error_t send_all(const uint8_t *data, nsapi_size_t size);
+    nsapi_error_t flush_stage();
+    void wait_for_room(int backoff_ms);
+    void on_sigio();
+
+    TCPSocket *_socket;
+    bool _non_blocking;
+    int _timeout_ms;
+    Semaphore _sigio;
+    Stats _stats;
+    nsapi_size_t _stage_len;
+    uint8_t _stage[TCP_STREAM_WRITER_STAGE_SIZE];
+};
+
+#endif
@@ -0,0 +1,226 @@
+/* TlsAllocator
+ * Copyright (c) 2017 MXCHIP Information Tech. Co.,Ltd
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "TlsAllocator.h"
+#include "mbedtls/platform.h"
+
+namespace {
+
+/* In front of every block, system heap and arena alike. In the arena the
+ * chunks follow each other; a chunk can be larger than what was asked for
+ * after rounding, an unsplit remainder or a merge. */
+union Header {
+    struct {
+        uint32_t chunk;     /**< Arena: chunk payload */
+        uint32_t size;      /**< Bytes asked for, 0 for a free arena chunk */
+    };
+    uint64_t align;
+};
+
+const size_t ALIGN = sizeof(Header);
+
+/* Smallest remainder worth splitting off a free arena chunk */
+const size_t MIN_SPLIT = sizeof(Header) + 16;
+
+int bucket_of(size_t size)
+{
+    int b = 0;
+    for (size_t limit = 16; b < TLS_ALLOCATOR_BUCKETS - 1 && size > limit; limit *= 4) {
+        b++;
+    }
+    return b;
+}
+
+}
+
+Mutex TlsAllocator::_mutex;
+TlsAllocator::Stats TlsAllocator::_stats;
+uint8_t *TlsAllocator::_arena;
+size_t TlsAllocator::_arena_size;
+int TlsAllocator::_arena_blocks;
+
+void TlsAllocator::install()
+{
+    mbedtls_platform_set_calloc_free(TlsAllocator::calloc, TlsAllocator::free);
+}
+
+void TlsAllocator::uninstall()
+{
+    mbedtls_platform_set_calloc_free(::calloc, ::free);
+}
+
+void TlsAllocator::use_arena(void *block, size_t size)
+{
+    _mutex.lock();
+    _arena = (uint8_t *) block;
+    _arena_size = size & ~(ALIGN - 1);
+    _arena_blocks = 0;
+
+    /* One free chunk spanning the arena */
+    Header *h = (Header *) _arena;
+    h->chunk = _arena_size - sizeof(Header);
+    h->size = 0;
+    _mutex.unlock();
+}
+
+int TlsAllocator::release_arena()
+{
+    _mutex.lock();
+    int leaked = _arena_blocks;
+    _arena = NULL;
+    _arena_size = 0;
+    _arena_blocks = 0;
+    _mutex.unlock();
+    return leaked;
+}
+
+void *TlsAllocator::arena_alloc(size_t size)
+{
+    uint8_t *end = _arena + _arena_size;
+    size_t chunk = (size + ALIGN - 1) & ~(ALIGN - 1);
+
+    for (uint8_t *p = _arena; p < end; p += sizeof(Header) + ((Header *) p)->chunk) {
+        Header *h = (Header *) p;
+        if (h->size) {
+            continue;
+        }
+
+        /* Merge the free chunks that follow, frees only mark their chunk */
+        uint8_t *next = p + sizeof(Header) + h->chunk;
+        while (next < end && !((Header *) next)->size) {
+            h->chunk += sizeof(Header) + ((Header *) next)->chunk;
+            next = p + sizeof(Header) + h->chunk;
+        }
+        if (h->chunk < chunk) {
+            continue;
+        }
+
+        if (h->chunk - chunk >= MIN_SPLIT) {
+            Header *rest = (Header *) (p + sizeof(Header) + chunk);
+            rest->chunk = h->chunk - chunk - sizeof(Header);
+            rest->size = 0;
+            h->chunk = chunk;
+        }
+        h->size = size;
+        _arena_blocks++;
+        return h + 1;
+    }
+    return NULL;
+}
+
+void TlsAllocator::arena_free(void *ptr)
+{
+    Header *h = (Header *) ptr - 1;
+    h->size = 0;
+    _arena_blocks--;
+}
+
+bool TlsAllocator::in_arena(const void *ptr)
+{
+    return _arena && (const uint8_t *) ptr > _arena && (const uint8_t *) ptr < _arena + _arena_size;
+}
+
+void *TlsAllocator::calloc(size_t n, size_t size)
+{
+    if (size && n > (UINT32_MAX - sizeof(Header)) / size) {
+        _stats.failures++;
+        return NULL;
+    }
+    /* Size 0 marks a free arena chunk, a zero byte block counts as one byte */
+    size_t bytes = n * size;
+    if (bytes == 0) {
+        bytes = 1;
+    }
+    void *ptr = NULL;
+    Header *h;
+
+    _mutex.lock();
+    if (_arena) {
+        ptr = arena_alloc(bytes);
+        if (ptr) {
+            memset(ptr, 0, bytes);
+        } else {
+            _stats.fallbacks++;
+        }
+    }
+    if (!ptr) {
+        h = (Header *) ::calloc(1, sizeof(Header) + bytes);
+        if (h) {
+            h->size = bytes;
+            ptr = h + 1;
+        }
+    }
+
+    if (!ptr) {
+        _stats.failures++;
+        _mutex.unlock();
+        return NULL;
+    }
+
+    _stats.current += bytes;
+    if (_stats.current > _stats.peak) {
+        _stats.peak = _stats.current;
+    }
+    _stats.allocs++;
+    _stats.histogram[bucket_of(bytes)]++;
+    _mutex.unlock();
+    return ptr;
+}
+
+void TlsAllocator::free(void *ptr)
+{
+    if (!ptr) {
+        return;
+    }
+
+    _mutex.lock();
+    Header *h = (Header *) ptr - 1;
+    bool arena = in_arena(ptr);
+
+    /* What calloc() counted, not the arena chunk it may have grown into */
+    _stats.current -= h->size;
+    _stats.frees++;
+    if (arena) {
+        arena_free(ptr);
+    } else {
+        ::free(h);
+    }
+    _mutex.unlock();
+}
+
+void TlsAllocator::reset_peak()
+{
+    _mutex.lock();
+    _stats.peak = _stats.current;
+    _mutex.unlock();
+}
+
+void TlsAllocator::print_stats(const char *title)
+{
+    static const char *const bucket_names[TLS_ALLOCATOR_BUCKETS] = {
+        "16", "64", "256", "1K", "4K", "16K", ">16K"
+    };
+
+    printf("%s: %lu bytes now, %lu peak, %lu allocs, %lu frees, %lu failed, %lu arena fallbacks\r\n",
+           title, (unsigned long)_stats.current, (unsigned long)_stats.peak,
+           (unsigned long)_stats.allocs, (unsigned long)_stats.frees,
+           (unsigned long)_stats.failures, (unsigned long)_stats.fallbacks);
+    printf("  sizes:");
+    for (int i = 0; i < TLS_ALLOCATOR_BUCKETS; i++) {
+        printf(" <=%s %lu", bucket_names[i], (unsigned long)_stats.histogram[i]);
+    }
+    printf("\r\n");
+}
@@ -0,0 +1,103 @@
+/* TlsAllocator
+ * Copyright (c) 2017 MXCHIP Information Tech. Co.,Ltd
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef TLS_ALLOCATOR_H
+#define TLS_ALLOCATOR_H
+
+#include "mbed.h"
+
+/* Allocation size classes: up to 16, 64, 256, 1K, 4K, 16K bytes and above */
+#define TLS_ALLOCATOR_BUCKETS       7
+
+/** TlsAllocator
+ *  The calloc/free of mbed TLS, installed with mbedtls_platform_set_calloc_free.
+ *  Needs MBEDTLS_PLATFORM_MEMORY.
+ *
+ *  Counting mode takes memory from the system heap and keeps current and
+ *  peak bytes, allocation counts and a size histogram.
+ *
+ *  Arena mode serves allocations from a caller supplied block, a private
+ *  first-fit heap, so the churn of a handshake never fragments the system
+ *  heap. release_arena() empties it at once when the connection is gone.
+ *  When the arena is full the system heap is used and counted as a
+ *  fallback; free() tells the two apart by address. The hooks are global,
+ *  so the arena serves one connection at a time; objects that outlive the
+ *  connection (a TlsSessionCache entry, the TlsEnvironment) must be
+ *  allocated before use_arena() or after release_arena().
+ *
+ *  Counting continues in both modes.
+ */
+class TlsAllocator {
+public:
+    /** Allocation statistics */
+    struct Stats {
+        uint32_t current;       /**< Bytes held by mbed TLS now */
+        uint32_t peak;          /**< Most bytes held since reset_peak() */
+        uint32_t allocs;        /**< Successful allocations */
+        uint32_t frees;         /**< Blocks returned */
+        uint32_t failures;      /**< Allocations that returned NULL */
+        uint32_t fallbacks;     /**< Arena full, served by the system heap */
+        uint32_t histogram[TLS_ALLOCATOR_BUCKETS]; /**< Allocations per size class */
+    };
+
+    /** Route mbed TLS allocations through the counting allocator */
+    static void install();
+
+    /** Give mbed TLS its calloc and free back
+     *
+     *  Only when mbed TLS holds no memory from this allocator any more.
+     */
+    static void uninstall();
+
+    /** Serve new allocations from a block
+     *
+     *  @param block    Arena memory, 8-byte aligned, unused while the arena is set
+     *  @param size     Size of block
+     */
+    static void use_arena(void *block, size_t size);
+
+    /** Drop everything in the arena and stop using it
+     *
+     *  Call after the connection's mbed TLS objects were freed.
+     *
+     *  @return     Arena blocks still allocated, i.e. leaked, before the release
+     */
+    static int release_arena();
+
+    /** Get the statistics */
+    static const Stats &stats() { return _stats; }
+
+    /** Restart the peak at the current value */
+    static void reset_peak();
+
+    /** Print the statistics */
+    static void print_stats(const char *title);
+
+private:
+    static void *calloc(size_t n, size_t size);
+    static void free(void *ptr);
+    static void *arena_alloc(size_t size);
+    static void arena_free(void *ptr);
+    static bool in_arena(const void *ptr);
+
+    static Mutex _mutex;
+    static Stats _stats;
+    static uint8_t *_arena;
+    static size_t _arena_size;
+    static int _arena_blocks;
+};
+
+#endif
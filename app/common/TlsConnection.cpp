@@ -0,0 +1,283 @@
+/* TlsConnection
+ * Copyright (c) 2017 MXCHIP Information Tech. Co.,Ltd
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "TlsConnection.h"
+
+TlsConnection::TlsConnection(TlsEnvironment *tls, SocketReactor *reactor, TlsSessionCache *sessions)
+    : _tls(tls), _reactor(reactor), _sessions(sessions), _state(STATE_CLOSED), _last_error(0),
+      _attached(false), _host(NULL), _port(0), _resumed(false), _handshake_ms(0),
+      _tx_off(0), _tx_len(0), _tx_inflight(0)
+{
+    mbedtls_ssl_init(&_ssl);
+    memset(&_stats, 0, sizeof(_stats));
+}
+
+TlsConnection::~TlsConnection()
+{
+    close();
+    mbedtls_ssl_free(&_ssl);
+}
+
+int TlsConnection::connect(NetworkInterface *net, const char *host, uint16_t port,
+                           EventHandler on_event, DnsCache *dns)
+{
+    int ret;
+
+    if (_state == STATE_HANDSHAKE || _state == STATE_OPEN) {
+        return NSAPI_ERROR_PARAMETER;
+    }
+    close();
+
+    /* Start from a fresh context, a previous connection may have used it */
+    mbedtls_ssl_free(&_ssl);
+    mbedtls_ssl_init(&_ssl);
+    memset(&_stats, 0, sizeof(_stats));
+    _on_event = on_event;
+    _host = host;
+    _port = port;
+    _last_error = 0;
+    _resumed = false;
+    _handshake_ms = 0;
+    _tx_off = _tx_len = _tx_inflight = 0;
+
+    ret = _tls->setup(&_ssl, host);
+    if (ret != 0) {
+        return ret;
+    }
+    mbedtls_ssl_set_bio(&_ssl, this, bio_send, bio_recv, NULL);
+    if (_sessions) {
+        _sessions->offer(&_ssl, host, port, &_offer);
+    }
+
+    ret = _socket.open(net);
+    if (ret != NSAPI_ERROR_OK) {
+        return ret;
+    }
+    ret = dns ? dns->connect(&_socket, host, port) : _socket.connect(host, port);
+    if (ret != NSAPI_ERROR_OK) {
+        _socket.close();
+        return ret;
+    }
+
+    _state = STATE_HANDSHAKE;
+    _handshake_timer.reset();
+    _handshake_timer.start();
+
+    /* Switches the socket to non-blocking and runs the first step */
+    ret = _reactor->add(&_socket, callback(this, &TlsConnection::on_socket));
+    if (ret != NSAPI_ERROR_OK) {
+        _state = STATE_CLOSED;
+        _socket.close();
+        return ret;
+    }
+    _attached = true;
+    return NSAPI_ERROR_OK;
+}
+
+void TlsConnection::on_socket()
+{
+    if (_state == STATE_HANDSHAKE) {
+        handshake();
+    }
+    if (_state != STATE_OPEN) {
+        return;
+    }
+
+    bool had_data = queued() > 0;
+    flush();
+    if (_state == STATE_OPEN && had_data && queued() == 0) {
+        _on_event(EVENT_WRITABLE);
+    }
+    if (_state == STATE_OPEN) {
+        _on_event(EVENT_READABLE);
+    }
+}
+
+void TlsConnection::handshake()
+{
+    int ret = mbedtls_ssl_handshake(&_ssl);
+
+    if (ret == MBEDTLS_ERR_SSL_WANT_READ || ret == MBEDTLS_ERR_SSL_WANT_WRITE) {
+        return;
+    }
+    if (ret != 0) {
+        if (_offer.offered) {
+            /* Do not offer a session the server chokes on again */
+            _sessions->forget(_host, _port);
+        }
+        fail(ret);
+        return;
+    }
+
+    _handshake_timer.stop();
+    _handshake_ms = _handshake_timer.read_ms();
+    if (_sessions && _sessions->save(&_ssl, _host, _port, &_offer) == 0) {
+        _resumed = _offer.resumed;
+    }
+
+    _state = STATE_OPEN;
+    _on_event(EVENT_CONNECTED);
+}
+
+void TlsConnection::flush()
+{
+    while (_tx_off < _tx_len) {
+        /* After WANT_WRITE mbed TLS holds the record already and only
+         * counts the length, so repeat it even if more data was queued */
+        nsapi_size_t len = _tx_inflight ? _tx_inflight : _tx_len - _tx_off;
+        int ret = mbedtls_ssl_write(&_ssl, _tx + _tx_off, len);
+
+        if (ret == MBEDTLS_ERR_SSL_WANT_WRITE || ret == MBEDTLS_ERR_SSL_WANT_READ) {
+            _tx_inflight = len;
+            return;
+        }
+        if (ret < 0) {
+            fail(ret);
+            return;
+        }
+
+        /* One record per call, shorter than len if above the fragment size */
+        _tx_inflight = 0;
+        _tx_off += ret;
+        _stats.bytes_sent += ret;
+        _stats.records_sent++;
+    }
+
+    _tx_off = _tx_len = 0;
+}
+
+nsapi_size_or_error_t TlsConnection::write(const void *data, nsapi_size_t size)
+{
+    if (_state != STATE_HANDSHAKE && _state != STATE_OPEN) {
+        return NSAPI_ERROR_NO_CONNECTION;
+    }
+
+    if (_tx_off > 0 && _tx_len + size > sizeof(_tx)) {
+        /* mbed TLS copied the data in flight already, moving it is safe */
+        memmove(_tx, _tx + _tx_off, _tx_len - _tx_off);
+        _tx_len -= _tx_off;
+        _tx_off = 0;
+    }
+
+    nsapi_size_t space = sizeof(_tx) - _tx_len;
+    if (space == 0) {
+        return NSAPI_ERROR_WOULD_BLOCK;
+    }
+    if (size > space) {
+        size = space;
+    }
+    memcpy(_tx + _tx_len, data, size);
+    _tx_len += size;
+
+    if (_state == STATE_OPEN && !_tx_inflight) {
+        /* Start sending now, the rest goes out on the next sigio */
+        _reactor->notify(&_socket);
+    }
+    return size;
+}
+
+nsapi_size_or_error_t TlsConnection::read(void *data, nsapi_size_t size)
+{
+    if (_state != STATE_OPEN) {
+        return _state == STATE_CLOSED ? 0 : NSAPI_ERROR_NO_CONNECTION;
+    }
+
+    bool new_record = mbedtls_ssl_get_bytes_avail(&_ssl) == 0;
+    int ret = mbedtls_ssl_read(&_ssl, (unsigned char *) data, size);
+
+    if (ret == MBEDTLS_ERR_SSL_WANT_READ || ret == MBEDTLS_ERR_SSL_WANT_WRITE) {
+        return NSAPI_ERROR_WOULD_BLOCK;
+    }
+    if (ret == 0 || ret == MBEDTLS_ERR_SSL_PEER_CLOSE_NOTIFY) {
+        /* Closed first, the peer is gone and gets no close_notify back */
+        _state = STATE_CLOSED;
+        close();
+        return 0;
+    }
+    if (ret < 0) {
+        _last_error = ret;
+        close();
+        _state = STATE_FAILED;
+        return ret;
+    }
+
+    if (new_record) {
+        _stats.records_received++;
+    }
+    _stats.bytes_received += ret;
+    return ret;
+}
+
+void TlsConnection::fail(int error)
+{
+    _last_error = error;
+    close();
+    _state = STATE_FAILED;
+    _on_event(EVENT_ERROR);
+}
+
+void TlsConnection::close()
+{
+    if (!_attached) {
+        return;
+    }
+
+    if (_state == STATE_OPEN) {
+        /* Best effort, a full socket buffer just drops the alert */
+        mbedtls_ssl_close_notify(&_ssl);
+    }
+    _reactor->remove(&_socket);
+    _socket.close();
+    _attached = false;
+    _state = STATE_CLOSED;
+}
+
+int TlsConnection::bio_send(void *ctx, const unsigned char *buf, size_t len)
+{
+    TlsConnection *conn = static_cast<TlsConnection *>(ctx);
+    nsapi_size_or_error_t n = conn->_socket.send(buf, len);
+
+    if (n == NSAPI_ERROR_WOULD_BLOCK) {
+        /* Never claim the bytes went out, mbed TLS keeps them and retries */
+        conn->_stats.want_write++;
+        return MBEDTLS_ERR_SSL_WANT_WRITE;
+    }
+    if (n < 0) {
+        return n;
+    }
+
+    if ((size_t) n < len) {
+        conn->_stats.partial_writes++;
+    }
+    conn->_stats.wire_sent += n;
+    return n;
+}
+
+int TlsConnection::bio_recv(void *ctx, unsigned char *buf, size_t len)
+{
+    TlsConnection *conn = static_cast<TlsConnection *>(ctx);
+    nsapi_size_or_error_t n = conn->_socket.recv(buf, len);
+
+    if (n == NSAPI_ERROR_WOULD_BLOCK) {
+        conn->_stats.want_read++;
+        return MBEDTLS_ERR_SSL_WANT_READ;
+    }
+    if (n > 0) {
+        conn->_stats.wire_received += n;
+    }
+    /* 0 is end of stream, mbed TLS reports it as a closed connection */
+    return n;
+}
@@ -0,0 +1,181 @@
+/* TlsConnection
+ * Copyright (c) 2017 MXCHIP Information Tech. Co.,Ltd
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef TLS_CONNECTION_H
+#define TLS_CONNECTION_H
+
+#include "mbed.h"
+#include "TCPSocket.h"
+#include "mbedtls/ssl.h"
+
+#include "SocketReactor.h"
+#include "TlsEnvironment.h"
+#include "TlsSessionCache.h"
+#include "DnsCache.h"
+
+/* Plaintext queued by write() until mbed TLS takes it */
+#define TLS_CONNECTION_TX_BUFFER    1024
+
+/** TlsConnection
+ *  One TLS client connection driven by a SocketReactor, so a single thread
+ *  can serve many of them without blocking or polling.
+ *
+ *  The TCP connect is blocking; from then on the socket is non-blocking.
+ *  Every sigio resumes the handshake, flushes queued data and raises
+ *  EVENT_READABLE. When the socket would block the BIO returns
+ *  MBEDTLS_ERR_SSL_WANT_READ or _WANT_WRITE and the step ends; the next
+ *  sigio picks it up where it stopped.
+ *
+ *  write() copies into a buffer. After WANT_WRITE mbed TLS must be called
+ *  again with the same length, so the length in flight is remembered and
+ *  more data queued meanwhile waits for the next record.
+ *
+ *  Events run on the reactor's thread. EVENT_READABLE may be spurious and
+ *  the handler should call read() until NSAPI_ERROR_WOULD_BLOCK, otherwise
+ *  data already decrypted by mbed TLS raises no new sigio.
+ */
+class TlsConnection {
+public:
+    enum State {
+        STATE_CLOSED,
+        STATE_HANDSHAKE,
+        STATE_OPEN,
+        STATE_FAILED,
+    };
+
+    enum Event {
+        EVENT_CONNECTED,    /**< Handshake done, queued data is being sent */
+        EVENT_READABLE,     /**< Application data may be waiting */
+        EVENT_WRITABLE,     /**< The write buffer drained */
+        EVENT_ERROR,        /**< The connection failed, see last_error() */
+    };
+
+    typedef Callback<void(Event)> EventHandler;
+
+    /** Traffic counters since connect() */
+    struct Stats {
+        uint32_t bytes_sent;        /**< Plaintext taken by mbed TLS */
+        uint32_t bytes_received;    /**< Plaintext returned by read() */
+        uint32_t records_sent;      /**< Application data records written */
+        uint32_t records_received;  /**< Application data records read */
+        uint32_t wire_sent;         /**< TCP payload sent, TLS overhead included */
+        uint32_t wire_received;     /**< TCP payload received */
+        uint32_t partial_writes;    /**< Socket sends that took only part of a record */
+        uint32_t want_read;         /**< Steps stopped waiting for data */
+        uint32_t want_write;        /**< Steps stopped waiting for buffer space */
+    };
+
+    /** Create a closed connection
+     *
+     *  @param tls          Initialized environment the connection is set up on
+     *  @param reactor      Reactor that drives the socket
+     *  @param sessions     Sessions to offer and keep, may be NULL
+     */
+    TlsConnection(TlsEnvironment *tls, SocketReactor *reactor, TlsSessionCache *sessions = NULL);
+
+    ~TlsConnection();
+
+    /** Connect and start the handshake
+     *
+     *  Returns once the TCP connection is up; the handshake then runs on
+     *  the reactor and ends with EVENT_CONNECTED or EVENT_ERROR.
+     *
+     *  @param net          Interface to connect through
+     *  @param host         Server host name, also verified against its certificate
+     *  @param port         Server port
+     *  @param on_event     Called on the reactor's thread
+     *  @param dns          Cache to resolve host through, may be NULL
+     *  @return             0 on success, negative NSAPI or mbed TLS error code on failure
+     */
+    int connect(NetworkInterface *net, const char *host, uint16_t port,
+                EventHandler on_event, DnsCache *dns = NULL);
+
+    /** Queue data, also allowed during the handshake
+     *
+     *  @return     Bytes queued, NSAPI_ERROR_WOULD_BLOCK if the buffer is
+     *              full, NSAPI_ERROR_NO_CONNECTION if not connected
+     */
+    nsapi_size_or_error_t write(const void *data, nsapi_size_t size);
+
+    /** Read decrypted data
+     *
+     *  End of stream and errors close the socket, connect() can follow.
+     *
+     *  @return     Bytes read, 0 when the server closed the connection,
+     *              NSAPI_ERROR_WOULD_BLOCK if nothing is waiting, or a
+     *              negative mbed TLS error code
+     */
+    nsapi_size_or_error_t read(void *data, nsapi_size_t size);
+
+    /** Send close_notify if possible and close the socket */
+    void close();
+
+    /** Get the connection state */
+    State state() const { return _state; }
+
+    /** Bytes queued by write() and not yet taken by mbed TLS */
+    nsapi_size_t queued() const { return _tx_len - _tx_off; }
+
+    /** Error that moved the connection to STATE_FAILED */
+    int last_error() const { return _last_error; }
+
+    /** Check if the handshake resumed a cached session */
+    bool resumed() const { return _resumed; }
+
+    /** Time from the first handshake step to the Finished messages */
+    uint32_t handshake_ms() const { return _handshake_ms; }
+
+    /** Get the traffic counters */
+    const Stats &stats() const { return _stats; }
+
+    /** Access the mbed TLS context, e.g. for the ciphersuite */
+    mbedtls_ssl_context *ssl() { return &_ssl; }
+
+private:
+    void on_socket();
+    void handshake();
+    void flush();
+    void fail(int error);
+
+    static int bio_send(void *ctx, const unsigned char *buf, size_t len);
+    static int bio_recv(void *ctx, unsigned char *buf, size_t len);
+
+    TlsEnvironment *_tls;
+    SocketReactor *_reactor;
+    TlsSessionCache *_sessions;
+    EventHandler _on_event;
+    TCPSocket _socket;
+    mbedtls_ssl_context _ssl;
+
+    State _state;
+    int _last_error;
+    bool _attached;                 /**< Socket open and watched by the reactor */
+    const char *_host;
+    uint16_t _port;
+    TlsSessionCache::Offer _offer;
+    bool _resumed;
+    Timer _handshake_timer;
+    uint32_t _handshake_ms;
+
+    uint8_t _tx[TLS_CONNECTION_TX_BUFFER];
+    nsapi_size_t _tx_off;           /**< Start of the data mbed TLS has not taken */
+    nsapi_size_t _tx_len;           /**< End of the queued data */
+    nsapi_size_t _tx_inflight;      /**< Length of a write that returned WANT_WRITE */
+
+    Stats _stats;
+};
+
+#endif
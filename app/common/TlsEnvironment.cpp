@@ -0,0 +1,145 @@
+/* TlsEnvironment
+ * Copyright (c) 2017 MXCHIP Information Tech. Co.,Ltd
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "TlsEnvironment.h"
+
+TlsEnvironment::TlsEnvironment(uint32_t reseed_ms)
+    : _ready(false), _reseed_ms(reseed_ms), _seeded_ms(0)
+{
+    _clock.start();
+    memset(&_stats, 0, sizeof(_stats));
+
+    mbedtls_entropy_init(&_entropy);
+    mbedtls_ctr_drbg_init(&_ctr_drbg);
+    mbedtls_x509_crt_init(&_cacert);
+    mbedtls_ssl_config_init(&_conf);
+}
+
+TlsEnvironment::~TlsEnvironment()
+{
+    mbedtls_ssl_config_free(&_conf);
+    mbedtls_x509_crt_free(&_cacert);
+    mbedtls_ctr_drbg_free(&_ctr_drbg);
+    mbedtls_entropy_free(&_entropy);
+}
+
+uint64_t TlsEnvironment::now_ms()
+{
+    return _clock.read_high_resolution_us() / 1000;
+}
+
+int TlsEnvironment::init(const char *ca_pem, size_t ca_pem_len, const char *pers, int transport)
+{
+    uint64_t start = _clock.read_high_resolution_us();
+    int ret;
+
+    if (_ready) {
+        return 0;
+    }
+
+    ret = mbedtls_ctr_drbg_seed(&_ctr_drbg, mbedtls_entropy_func, &_entropy,
+                                (const unsigned char *) pers, strlen(pers));
+    if (ret != 0) {
+        return ret;
+    }
+    _seeded_ms = now_ms();
+    _stats.seed_us = _clock.read_high_resolution_us() - start;
+
+    if (ca_pem) {
+        uint64_t parse_start = _clock.read_high_resolution_us();
+        ret = mbedtls_x509_crt_parse(&_cacert, (const unsigned char *) ca_pem, ca_pem_len);
+        if (ret != 0) {
+            return ret;
+        }
+        _stats.ca_parse_us = _clock.read_high_resolution_us() - parse_start;
+    }
+
+    ret = mbedtls_ssl_config_defaults(&_conf, MBEDTLS_SSL_IS_CLIENT, transport,
+                                      MBEDTLS_SSL_PRESET_DEFAULT);
+    if (ret != 0) {
+        return ret;
+    }
+    mbedtls_ssl_conf_ca_chain(&_conf, &_cacert, NULL);
+    mbedtls_ssl_conf_rng(&_conf, random, this);
+    mbedtls_ssl_conf_authmode(&_conf, MBEDTLS_SSL_VERIFY_REQUIRED);
+#if defined(TLS_MEMORY_MAX_FRAG_LEN) && defined(MBEDTLS_SSL_MAX_FRAGMENT_LENGTH)
+    /* The memory profile shrank the record buffers, the server must too */
+    mbedtls_ssl_conf_max_frag_len(&_conf, TLS_MEMORY_MAX_FRAG_LEN);
+#endif
+
+    _stats.init_us = _clock.read_high_resolution_us() - start;
+    _ready = true;
+    return 0;
+}
+
+int TlsEnvironment::random(void *env, unsigned char *output, size_t len)
+{
+    TlsEnvironment *self = static_cast<TlsEnvironment *>(env);
+
+    self->_drbg_mutex.lock();
+    int ret = mbedtls_ctr_drbg_random(&self->_ctr_drbg, output, len);
+    self->_drbg_mutex.unlock();
+    return ret;
+}
+
+int TlsEnvironment::reseed()
+{
+    _drbg_mutex.lock();
+    int ret = mbedtls_ctr_drbg_reseed(&_ctr_drbg, NULL, 0);
+    _drbg_mutex.unlock();
+
+    if (ret == 0) {
+        _seeded_ms = now_ms();
+        _stats.reseeds++;
+    }
+    return ret;
+}
+
+int TlsEnvironment::setup(mbedtls_ssl_context *ssl, const char *hostname)
+{
+    int ret;
+
+    if (!_ready) {
+        return MBEDTLS_ERR_SSL_BAD_INPUT_DATA;
+    }
+
+    if (_reseed_ms && now_ms() - _seeded_ms > _reseed_ms) {
+        /* A failed reseed leaves the DRBG usable, try again next time */
+        reseed();
+    }
+
+    ret = mbedtls_ssl_setup(ssl, &_conf);
+    if (ret != 0) {
+        return ret;
+    }
+    if (hostname) {
+        ret = mbedtls_ssl_set_hostname(ssl, hostname);
+        if (ret != 0) {
+            return ret;
+        }
+    }
+
+    _stats.setups++;
+    return 0;
+}
+
+void TlsEnvironment::print_stats(const char *title) const
+{
+    printf("%s: init %lu us (seed %lu us, CA parse %lu us), %lu setups, %lu reseeds, %u bytes static\r\n",
+           title, (unsigned long)_stats.init_us, (unsigned long)_stats.seed_us,
+           (unsigned long)_stats.ca_parse_us, (unsigned long)_stats.setups,
+           (unsigned long)_stats.reseeds, (unsigned)sizeof(TlsEnvironment));
+}
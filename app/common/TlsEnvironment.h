@@ -0,0 +1,125 @@
+/* TlsEnvironment
+ * Copyright (c) 2017 MXCHIP Information Tech. Co.,Ltd
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef TLS_ENVIRONMENT_H
+#define TLS_ENVIRONMENT_H
+
+#include "mbed.h"
+#include "mbedtls/ssl.h"
+#include "mbedtls/entropy.h"
+#include "mbedtls/ctr_drbg.h"
+
+/* The DRBG is reseeded from the entropy source when a connection is set
+ * up this long after the last seed */
+#define TLS_ENVIRONMENT_RESEED_MS   (60 * 60 * 1000)
+
+/** TlsEnvironment
+ *  The process wide part of a TLS client: entropy source, CTR_DRBG, parsed
+ *  CA chain and one mbedtls_ssl_config.
+ *
+ *  init() does the expensive work once: seeding the DRBG, base64 decoding
+ *  and ASN.1 parsing the CA certificates and filling the config. Every
+ *  connection then only needs an mbedtls_ssl_context passed to setup().
+ *
+ *  The DRBG is guarded by a mutex so connections in several threads can
+ *  share it; the config and CA chain are only read once init() returned.
+ *  Change the config through config() before the first setup() only.
+ */
+class TlsEnvironment {
+public:
+    /** Cost of the shared state and its use */
+    struct Stats {
+        uint32_t init_us;       /**< Whole init() */
+        uint32_t seed_us;       /**< Entropy gathering and DRBG seed */
+        uint32_t ca_parse_us;   /**< CA chain decoding and parsing */
+        uint32_t setups;        /**< Connections set up */
+        uint32_t reseeds;       /**< DRBG reseeds after init() */
+    };
+
+    /** Create an uninitialized environment
+     *
+     *  @param reseed_ms    Reseed the DRBG when it is older than this, 0 to never
+     */
+    TlsEnvironment(uint32_t reseed_ms = TLS_ENVIRONMENT_RESEED_MS);
+
+    ~TlsEnvironment();
+
+    /** Seed the DRBG, parse the CA chain and fill the client config
+     *
+     *  @param ca_pem       CA certificates, PEM, including the terminating NUL;
+     *                      NULL for none, then relax the authmode through config()
+     *  @param ca_pem_len   Size of ca_pem
+     *  @param pers         DRBG personalization string
+     *  @param transport    MBEDTLS_SSL_TRANSPORT_STREAM or _DATAGRAM
+     *  @return             0 on success, negative mbed TLS error code on failure
+     */
+    int init(const char *ca_pem, size_t ca_pem_len, const char *pers,
+             int transport = MBEDTLS_SSL_TRANSPORT_STREAM);
+
+    /** Check if init() succeeded */
+    bool ready() const { return _ready; }
+
+    /** Set up a connection on the shared config
+     *
+     *  Reseeds the DRBG first when it is due.
+     *
+     *  @param ssl          Initialized context, not yet set up
+     *  @param hostname     Server name to verify and send as SNI, may be NULL
+     *  @return             0 on success, negative mbed TLS error code on failure
+     */
+    int setup(mbedtls_ssl_context *ssl, const char *hostname);
+
+    /** Reseed the DRBG from the entropy source now
+     *
+     *  @return             0 on success, negative mbed TLS error code on failure
+     */
+    int reseed();
+
+    /** Random number callback on the shared DRBG, for mbedtls_xxx(f_rng, p_rng)
+     *
+     *  @param env          The TlsEnvironment
+     */
+    static int random(void *env, unsigned char *output, size_t len);
+
+    /** The shared client config */
+    mbedtls_ssl_config *config() { return &_conf; }
+
+    /** The parsed CA chain */
+    mbedtls_x509_crt *ca_chain() { return &_cacert; }
+
+    /** Get the cost figures */
+    const Stats &stats() const { return _stats; }
+
+    /** Print the cost figures */
+    void print_stats(const char *title) const;
+
+private:
+    uint64_t now_ms();
+
+    bool _ready;
+    uint32_t _reseed_ms;
+    uint64_t _seeded_ms;
+    Timer _clock;
+    Mutex _drbg_mutex;
+    Stats _stats;
+
+    mbedtls_entropy_context _entropy;
+    mbedtls_ctr_drbg_context _ctr_drbg;
+    mbedtls_x509_crt _cacert;
+    mbedtls_ssl_config _conf;
+};
+
+#endif
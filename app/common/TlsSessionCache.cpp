@@ -0,0 +1,161 @@
+/* TlsSessionCache
+ * Copyright (c) 2017 MXCHIP Information Tech. Co.,Ltd
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "TlsSessionCache.h"
+
+TlsSessionCache::TlsSessionCache(uint32_t max_age_ms)
+    : _max_age_ms(max_age_ms)
+{
+    _clock.start();
+    for (int i = 0; i < TLS_SESSION_CACHE_ENTRIES; i++) {
+        _entries[i].host[0] = '\0';
+        mbedtls_ssl_session_init(&_entries[i].session);
+    }
+    memset(&_stats, 0, sizeof(_stats));
+}
+
+TlsSessionCache::~TlsSessionCache()
+{
+    flush();
+}
+
+uint64_t TlsSessionCache::now_ms()
+{
+    return _clock.read_high_resolution_us() / 1000;
+}
+
+void TlsSessionCache::enable_tickets(mbedtls_ssl_config *conf)
+{
+#if defined(MBEDTLS_SSL_SESSION_TICKETS)
+    mbedtls_ssl_conf_session_tickets(conf, MBEDTLS_SSL_SESSION_TICKETS_ENABLED);
+#else
+    (void) conf;
+#endif
+}
+
+TlsSessionCache::Entry *TlsSessionCache::find(const char *host, uint16_t port)
+{
+    for (int i = 0; i < TLS_SESSION_CACHE_ENTRIES; i++) {
+        if (_entries[i].host[0] && _entries[i].port == port && strcmp(_entries[i].host, host) == 0) {
+            return &_entries[i];
+        }
+    }
+    return NULL;
+}
+
+void TlsSessionCache::clear(Entry *e)
+{
+    /* The session holds the master secret, wipe it with the entry */
+    mbedtls_ssl_session_free(&e->session);
+    mbedtls_ssl_session_init(&e->session);
+    e->host[0] = '\0';
+}
+
+bool TlsSessionCache::offer(mbedtls_ssl_context *ssl, const char *host, uint16_t port, Offer *offer)
+{
+    offer->offered = false;
+    offer->resumed = false;
+
+    Entry *e = find(host, port);
+    if (!e) {
+        return false;
+    }
+    if (now_ms() - e->saved_ms > _max_age_ms) {
+        clear(e);
+        return false;
+    }
+    if (mbedtls_ssl_set_session(ssl, &e->session) != 0) {
+        return false;
+    }
+
+    /* The entry may be replaced by another connection's save() before
+     * this handshake ends, keep what save() compares against */
+    memcpy(offer->master, e->session.master, sizeof(offer->master));
+    offer->offered = true;
+    _stats.offered++;
+    return true;
+}
+
+int TlsSessionCache::save(mbedtls_ssl_context *ssl, const char *host, uint16_t port, Offer *offer)
+{
+    if (offer->offered) {
+        /* A resumed session keeps its master secret, a full handshake
+         * derives a new one. Comparing session IDs would not work for
+         * tickets, the client sends a random ID with every ticket. */
+        const mbedtls_ssl_session *now = ssl->session;
+        offer->resumed = now && memcmp(now->master, offer->master, sizeof(offer->master)) == 0;
+        if (offer->resumed) {
+            _stats.resumed++;
+        } else {
+            _stats.rejected++;
+        }
+        offer->offered = false;
+    }
+
+    if (strlen(host) >= TLS_SESSION_CACHE_HOST_SIZE) {
+        return MBEDTLS_ERR_SSL_BAD_INPUT_DATA;
+    }
+
+    Entry *e = find(host, port);
+    if (!e) {
+        /* Take a free entry, or the oldest one */
+        e = &_entries[0];
+        for (int i = 0; i < TLS_SESSION_CACHE_ENTRIES; i++) {
+            if (!_entries[i].host[0]) {
+                e = &_entries[i];
+                break;
+            }
+            if (_entries[i].saved_ms < e->saved_ms) {
+                e = &_entries[i];
+            }
+        }
+    }
+
+    clear(e);
+    int ret = mbedtls_ssl_get_session(ssl, &e->session);
+    if (ret != 0) {
+        clear(e);
+        return ret;
+    }
+
+    strcpy(e->host, host);
+    e->port = port;
+    e->saved_ms = now_ms();
+    _stats.saved++;
+    return 0;
+}
+
+void TlsSessionCache::forget(const char *host, uint16_t port)
+{
+    Entry *e = find(host, port);
+    if (e) {
+        clear(e);
+    }
+}
+
+void TlsSessionCache::flush()
+{
+    for (int i = 0; i < TLS_SESSION_CACHE_ENTRIES; i++) {
+        clear(&_entries[i]);
+    }
+}
+
+void TlsSessionCache::print_stats(const char *title) const
+{
+    printf("%s: %lu offered, %lu resumed, %lu rejected, %lu saved\r\n", title,
+           (unsigned long)_stats.offered, (unsigned long)_stats.resumed,
+           (unsigned long)_stats.rejected, (unsigned long)_stats.saved);
+}
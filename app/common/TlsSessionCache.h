@@ -0,0 +1,136 @@
+/* TlsSessionCache
+ * Copyright (c) 2017 MXCHIP Information Tech. Co.,Ltd
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef TLS_SESSION_CACHE_H
+#define TLS_SESSION_CACHE_H
+
+#include "mbed.h"
+#include "mbedtls/ssl.h"
+
+/* Number of servers a session is kept for, the oldest one is replaced.
+ * Each entry holds a copy of the server certificate, about 1-2 KB. */
+#define TLS_SESSION_CACHE_ENTRIES   2
+
+/* Longest host name cached, sessions of longer names are not kept */
+#define TLS_SESSION_CACHE_HOST_SIZE 64
+
+/* Sessions older than this are not offered. Servers usually keep their
+ * session cache and ticket keys for hours, a day at most. */
+#define TLS_SESSION_CACHE_MAX_AGE_MS (60 * 60 * 1000)
+
+/** TlsSessionCache
+ *  Client side TLS session store for abbreviated handshakes.
+ *
+ *  After a full handshake save() keeps a copy of the negotiated session,
+ *  including the RFC 5077 ticket when the server sent one. The next
+ *  connection to the same host and port calls offer() before
+ *  mbedtls_ssl_handshake(); a server that still knows the session ID or
+ *  can decrypt the ticket skips the certificate and key exchange.
+ *
+ *  Several connections to one server may be in their handshakes at the
+ *  same time, so what was offered on a connection is kept by its owner in
+ *  an Offer, passed from offer() to save(). Offer::resumed tells
+ *  afterwards which kind of handshake took place.
+ *
+ *  Session tickets are enabled on an ssl_config with enable_tickets().
+ */
+class TlsSessionCache {
+public:
+    /** Session statistics, all counters since construction */
+    struct Stats {
+        uint32_t offered;       /**< Handshakes started with a cached session */
+        uint32_t resumed;       /**< Offers the server accepted */
+        uint32_t rejected;      /**< Offers the server answered with a full handshake */
+        uint32_t saved;         /**< Sessions stored after a handshake */
+    };
+
+    /** Session offered on one connection, owned by the connection */
+    struct Offer {
+        bool offered;                   /**< A cached session was offered */
+        bool resumed;                   /**< The server accepted it, set by save() */
+        unsigned char master[48];       /**< Master secret of the offered session */
+
+        Offer() : offered(false), resumed(false) {}
+    };
+
+    /** Create an empty cache
+     *
+     *  @param max_age_ms   Sessions older than this are dropped instead of offered
+     */
+    TlsSessionCache(uint32_t max_age_ms = TLS_SESSION_CACHE_MAX_AGE_MS);
+
+    ~TlsSessionCache();
+
+    /** Let the client ask for and store RFC 5077 session tickets
+     *
+     *  @param conf     Configuration, before mbedtls_ssl_setup()
+     */
+    static void enable_tickets(mbedtls_ssl_config *conf);
+
+    /** Offer the cached session of a server on a new connection
+     *
+     *  @param ssl      Context after mbedtls_ssl_setup(), before the handshake
+     *  @param host     Server host name
+     *  @param port     Server port
+     *  @param offer    State of this connection, kept until save()
+     *  @return         True if a session was offered
+     */
+    bool offer(mbedtls_ssl_context *ssl, const char *host, uint16_t port, Offer *offer);
+
+    /** Store the session of a completed handshake
+     *
+     *  Also sets offer->resumed if the server accepted the session offered
+     *  on this connection.
+     *
+     *  @param ssl      Context after a successful handshake
+     *  @param host     Server host name
+     *  @param port     Server port
+     *  @param offer    State of this connection passed to offer()
+     *  @return         0 on success, negative mbed TLS error code on failure
+     */
+    int save(mbedtls_ssl_context *ssl, const char *host, uint16_t port, Offer *offer);
+
+    /** Drop the session of a server, e.g. after a failed handshake */
+    void forget(const char *host, uint16_t port);
+
+    /** Drop all sessions */
+    void flush();
+
+    /** Get the session statistics */
+    const Stats &stats() const { return _stats; }
+
+    /** Print the session statistics */
+    void print_stats(const char *title) const;
+
+private:
+    struct Entry {
+        char host[TLS_SESSION_CACHE_HOST_SIZE];
+        uint16_t port;
+        uint64_t saved_ms;
+        mbedtls_ssl_session session;
+    };
+
+    Entry *find(const char *host, uint16_t port);
+    void clear(Entry *e);
+    uint64_t now_ms();
+
+    uint32_t _max_age_ms;
+    Timer _clock;
+    Stats _stats;
+    Entry _entries[TLS_SESSION_CACHE_ENTRIES];
+};
+
+#endif
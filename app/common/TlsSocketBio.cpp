@@ -0,0 +1,29 @@
+/* TlsSocketBio
+ * Copyright (c) 2017 MXCHIP Information Tech. Co.,Ltd
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "TlsSocketBio.h"
+
+int TlsSocketBio::send(void *ctx, const unsigned char *buf, size_t len)
+{
+    nsapi_size_or_error_t n = static_cast<TCPSocket *>(ctx)->send(buf, len);
+    return n == NSAPI_ERROR_WOULD_BLOCK ? MBEDTLS_ERR_SSL_WANT_WRITE : n;
+}
+
+int TlsSocketBio::recv(void *ctx, unsigned char *buf, size_t len)
+{
+    nsapi_size_or_error_t n = static_cast<TCPSocket *>(ctx)->recv(buf, len);
+    return n == NSAPI_ERROR_WOULD_BLOCK ? MBEDTLS_ERR_SSL_WANT_READ : n;
+}
@@ -0,0 +1,42 @@
+/* TlsSocketBio
+ * Copyright (c) 2017 MXCHIP Information Tech. Co.,Ltd
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef TLS_SOCKET_BIO_H
+#define TLS_SOCKET_BIO_H
+
+#include "mbed.h"
+#include "TCPSocket.h"
+#include "mbedtls/ssl.h"
+
+/** TlsSocketBio
+ *  mbed TLS send and receive callbacks over a TCPSocket.
+ *
+ *  Pass the socket as the context of mbedtls_ssl_set_bio(). A socket
+ *  that would block, non-blocking or after a timeout, is reported as
+ *  MBEDTLS_ERR_SSL_WANT_WRITE or MBEDTLS_ERR_SSL_WANT_READ so mbed TLS
+ *  keeps its state and the call can be repeated; other socket errors are
+ *  returned as they are.
+ */
+class TlsSocketBio {
+public:
+    /** mbedtls_ssl_send_t on a TCPSocket given as ctx */
+    static int send(void *ctx, const unsigned char *buf, size_t len);
+
+    /** mbedtls_ssl_recv_t on a TCPSocket given as ctx */
+    static int recv(void *ctx, unsigned char *buf, size_t len);
+};
+
+#endif
@@ -0,0 +1,205 @@
+/* WiFiScanner
+ * Copyright (c) 2017 MXCHIP Information Tech. Co.,Ltd
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "WiFiScanner.h"
+
+static nsapi_security_t mico_to_nsapi_security(wlan_sec_type_t security)
+{
+    switch (security) {
+        case SECURITY_TYPE_NONE:
+            return NSAPI_SECURITY_NONE;
+        case SECURITY_TYPE_WEP:
+            return NSAPI_SECURITY_WEP;
+        case SECURITY_TYPE_WPA_TKIP:
+        case SECURITY_TYPE_WPA_AES:
+            return NSAPI_SECURITY_WPA;
+        case SECURITY_TYPE_WPA2_TKIP:
+        case SECURITY_TYPE_WPA2_AES:
+            return NSAPI_SECURITY_WPA2;
+        case SECURITY_TYPE_WPA2_MIXED:
+            return NSAPI_SECURITY_WPA_WPA2;
+        default:
+            return NSAPI_SECURITY_UNKNOWN;
+    }
+}
+
+WiFiScanner::WiFiScanner(uint32_t max_age_ms)
+    : _max_age_ms(max_age_ms), _registered(false), _busy(false), _count(0)
+{
+}
+
+WiFiScanner::~WiFiScanner()
+{
+    if (_registered) {
+        mico_system_notify_remove(mico_notify_WIFI_SCAN_ADV_COMPLETED,
+                                  (void *)&WiFiScanner::on_scan_complete);
+    }
+}
+
+nsapi_error_t WiFiScanner::start(ResultHandler on_result)
+{
+    if (_busy) {
+        return NSAPI_ERROR_WOULD_BLOCK;
+    }
+
+    if (!_registered) {
+        if (mico_system_notify_register(mico_notify_WIFI_SCAN_ADV_COMPLETED,
+                                        (void *)&WiFiScanner::on_scan_complete, this) != kNoErr) {
+            return NSAPI_ERROR_DEVICE_ERROR;
+        }
+        _registered = true;
+    }
+
+    _on_result = on_result;
+    _busy = true;
+    /* A result of an earlier, abandoned scan must not end this one */
+    while (_done.wait(0) > 0) {
+    }
+
+    if (micoWlanStartScanAdv() != kNoErr) {
+        _busy = false;
+        return NSAPI_ERROR_DEVICE_ERROR;
+    }
+    return NSAPI_ERROR_OK;
+}
+
+nsapi_size_or_error_t WiFiScanner::wait(int timeout_ms)
+{
+    if (_busy && _done.wait(timeout_ms) <= 0) {
+        _busy = false;
+        return NSAPI_ERROR_DEVICE_ERROR;
+    }
+    return count();
+}
+
+nsapi_size_or_error_t WiFiScanner::scan(ResultHandler on_result)
+{
+    nsapi_error_t err = start(on_result);
+    if (err != NSAPI_ERROR_OK) {
+        return err;
+    }
+    return wait();
+}
+
+void WiFiScanner::on_scan_complete(ScanResult_adv *result, void *context)
+{
+    WiFiScanner *scanner = static_cast<WiFiScanner *>(context);
+
+    /* Scans started by others, e.g. WiFiInterface::scan(), are ignored */
+    if (!scanner->_busy) {
+        return;
+    }
+    scanner->store(result);
+    scanner->_busy = false;
+    scanner->_done.release();
+}
+
+void WiFiScanner::store(ScanResult_adv *result)
+{
+    _mutex.lock();
+    _count = 0;
+
+    for (int i = 0; i < (uint8_t)result->ApNum; i++) {
+        nsapi_wifi_ap_t ap;
+
+        memset(&ap, 0, sizeof(ap));
+        strncpy(ap.ssid, result->ApList[i].ssid, sizeof(ap.ssid) - 1);
+        memcpy(ap.bssid, result->ApList[i].bssid, sizeof(ap.bssid));
+        ap.security = mico_to_nsapi_security(result->ApList[i].security);
+        ap.rssi = result->ApList[i].rssi;
+        ap.channel = result->ApList[i].channel;
+
+        WiFiAccessPoint entry(ap);
+        if (_on_result) {
+            _on_result(entry);
+        }
+
+        /* Insertion into the table sorted by RSSI, the weakest falls off */
+        int pos = _count;
+        while (pos > 0 && _aps[pos - 1].get_rssi() < ap.rssi) {
+            pos--;
+        }
+        if (pos >= WIFI_SCANNER_MAX_APS) {
+            continue;
+        }
+        int last = _count < WIFI_SCANNER_MAX_APS ? _count : WIFI_SCANNER_MAX_APS - 1;
+        for (int j = last; j > pos; j--) {
+            _aps[j] = _aps[j - 1];
+        }
+        _aps[pos] = entry;
+        if (_count < WIFI_SCANNER_MAX_APS) {
+            _count++;
+        }
+    }
+
+    _age.reset();
+    _age.start();
+    _mutex.unlock();
+}
+
+bool WiFiScanner::fresh()
+{
+    return _count > 0 && _age.read_high_resolution_us() / 1000 < _max_age_ms;
+}
+
+int WiFiScanner::count()
+{
+    _mutex.lock();
+    int count = fresh() ? _count : 0;
+    _mutex.unlock();
+    return count;
+}
+
+const WiFiAccessPoint *WiFiScanner::get(int index)
+{
+    if (index < 0 || index >= count()) {
+        return NULL;
+    }
+    return &_aps[index];
+}
+
+const WiFiAccessPoint *WiFiScanner::find(const char *ssid)
+{
+    const WiFiAccessPoint *found = NULL;
+
+    _mutex.lock();
+    if (fresh()) {
+        for (int i = 0; i < _count; i++) {
+            if (strcmp(_aps[i].get_ssid(), ssid) == 0) {
+                found = &_aps[i];
+                break;
+            }
+        }
+    }
+    _mutex.unlock();
+    return found;
+}
+
+nsapi_error_t WiFiScanner::connect(EMW10xxInterface *wifi, const char *ssid, const char *pass,
+                                   nsapi_security_t security)
+{
+    const WiFiAccessPoint *ap = find(ssid);
+
+    /* Channel 0 lets the driver search all channels */
+    return wifi->connect(ssid, pass, security, ap ? ap->get_channel() : 0);
+}
+
+void WiFiScanner::flush()
+{
+    _mutex.lock();
+    _count = 0;
+    _mutex.unlock();
+}
@@ -0,0 +1,127 @@
+/* WiFiScanner
+ * Copyright (c) 2017 MXCHIP Information Tech. Co.,Ltd
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef WIFI_SCANNER_H
+#define WIFI_SCANNER_H
+
+#include "mbed.h"
+#include "mico.h"
+#include "EMW10xxInterface.h"
+
+/* Access points kept, the weakest ones are dropped */
+#define WIFI_SCANNER_MAX_APS        15
+
+/* Cached results older than this are not used */
+#define WIFI_SCANNER_MAX_AGE_MS     (60 * 1000)
+
+/* Longest time a scan is waited for */
+#define WIFI_SCANNER_TIMEOUT_MS     10000
+
+/** WiFiScanner
+ *  Scans once and keeps the results.
+ *
+ *  WiFiInterface::scan() has to be called twice, once for the count and
+ *  once for the results. WiFiScanner starts a single MiCO scan, passes
+ *  each access point to a callback when the scan reports and keeps the
+ *  strongest WIFI_SCANNER_MAX_APS in a fixed table sorted by RSSI. A
+ *  later connect takes the channel from the table instead of scanning.
+ *
+ *  Only one scanner should exist at a time; the callback runs in the MiCO
+ *  notification thread. The scanner registers for MiCO scan notifications
+ *  on its first scan, so it can be constructed before MiCO is up.
+ */
+class WiFiScanner {
+public:
+    typedef Callback<void(const WiFiAccessPoint &)> ResultHandler;
+
+    /** Create a scanner
+     *
+     *  @param max_age_ms   Age after which cached results are not used
+     */
+    WiFiScanner(uint32_t max_age_ms = WIFI_SCANNER_MAX_AGE_MS);
+
+    /** Stop listening for scan results */
+    ~WiFiScanner();
+
+    /** Start a scan and return at once
+     *
+     *  @param on_result    Called for each access point found, may be empty
+     *  @return             0 on success, NSAPI_ERROR_WOULD_BLOCK if a scan is running
+     */
+    nsapi_error_t start(ResultHandler on_result = ResultHandler());
+
+    /** Wait for the running scan
+     *
+     *  @param timeout_ms   Longest wait
+     *  @return             Number of access points cached, or negative error code
+     */
+    nsapi_size_or_error_t wait(int timeout_ms = WIFI_SCANNER_TIMEOUT_MS);
+
+    /** Scan and wait for the results
+     *
+     *  @param on_result    Called for each access point found, may be empty
+     *  @return             Number of access points cached, or negative error code
+     */
+    nsapi_size_or_error_t scan(ResultHandler on_result = ResultHandler());
+
+    /** Number of cached access points, 0 once the results are too old */
+    int count();
+
+    /** Cached access point, strongest first
+     *
+     *  @param index    0 to count() - 1
+     *  @return         Access point valid until the next scan, or NULL if out of range
+     */
+    const WiFiAccessPoint *get(int index);
+
+    /** Strongest cached access point with a given SSID
+     *
+     *  @return     Access point valid until the next scan, or NULL if not found
+     *              or the results are too old
+     */
+    const WiFiAccessPoint *find(const char *ssid);
+
+    /** Connect using the channel of the cached access point, if any
+     *
+     *  @param wifi         Interface to connect
+     *  @param ssid         Network name
+     *  @param pass         Passphrase
+     *  @param security     Security type
+     *  @return             0 on success, negative error code on failure
+     */
+    nsapi_error_t connect(EMW10xxInterface *wifi, const char *ssid, const char *pass,
+                          nsapi_security_t security = NSAPI_SECURITY_WPA_WPA2);
+
+    /** Drop the cached results */
+    void flush();
+
+private:
+    static void on_scan_complete(ScanResult_adv *result, void *context);
+    void store(ScanResult_adv *result);
+    bool fresh();
+
+    uint32_t _max_age_ms;
+    ResultHandler _on_result;
+    bool _registered;
+    volatile bool _busy;
+    Semaphore _done;
+    Mutex _mutex;
+    Timer _age;
+    int _count;
+    WiFiAccessPoint _aps[WIFI_SCANNER_MAX_APS];
+};
+
+#endif
@@ -0,0 +1,317 @@
+/* DTLS benchmark
+ * Copyright (c) 2017 MXCHIP Information Tech. Co.,Ltd
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/** \file dtls_bench_main.cpp
+ *  \brief Round trip latency of small telemetry messages over DTLS and
+ *  over TLS/TCP, with and without loss.
+ *
+ *  Servers, mbed TLS's programs/ssl/ssl_server2 on a Linux host the device
+ *  can reach, one per transport on the same port number:
+ *      ssl_server2 dtls=1 server_port=4433 exchanges=100000 hs_timeout=500-8000
+ *      ssl_server2 server_port=4433 exchanges=100000
+ *  The DTLS server sends HelloVerifyRequest by default (cookies=1). Both
+ *  answer each message with one short response.
+ *
+ *  DTLS is first connected twice to show the full and the resumed
+ *  handshake, then DTLS_BENCH_MESSAGES messages are sent one at a time
+ *  at each loss in loss_percent, dropped inside DtlsClient. A message whose
+ *  answer does not come within DTLS_BENCH_TIMEOUT_MS is lost; nothing waits
+ *  for it, and if it comes later it is read and dropped before the next
+ *  message is sent. ssl_server2 answers every message the same way, so a
+ *  reply can not be matched to its message by content. Loss cannot be injected into a TCP stream by the client, so the
+ *  TLS/TCP row runs on the link as it is. To compare both under the same
+ *  loss, add it on the server host and look at the 0% DTLS row:
+ *      tc qdisc add dev eth0 root netem loss 5%
+ *      tc qdisc del dev eth0 root
+ *  TCP then retransmits, and every message behind a lost segment waits for
+ *  it: compare the 95th percentile and maximum.
+ */
+
+#include "mbed.h"
+#include "us_ticker_api.h"
+#include "TCPSocket.h"
+#include "EMW10xxInterface.h"
+#include "DnsCache.h"
+#include "DtlsClient.h"
+#include "TlsEnvironment.h"
+#include "TlsSessionCache.h"
+#include "TlsSocketBio.h"
+
+#include "mbedtls/ssl.h"
+#include "mbedtls/error.h"
+
+namespace {
+
+const int DTLS_BENCH_MESSAGES = 100;
+const uint32_t DTLS_BENCH_TIMEOUT_MS = 500;
+
+/* Wait for queued stale replies before each message, enough to read a
+ * datagram that is already there */
+const uint32_t DTLS_BENCH_DRAIN_MS = 1;
+
+/* Handshake retransmission: first after 500 ms, doubling up to 8 s */
+const uint32_t DTLS_BENCH_HS_MIN_MS = 500;
+const uint32_t DTLS_BENCH_HS_MAX_MS = 8000;
+
+const uint32_t loss_percent[] = { 0, 5, 10, 20 };
+const int LOSS_STEPS = sizeof(loss_percent) / sizeof(loss_percent[0]);
+
+const char *DRBG_PERS = "dtls bench";
+
+struct LatencyResult {
+    int delivered;
+    int lost;
+    uint32_t avg_ms;
+    uint32_t p95_ms;
+    uint32_t max_ms;
+};
+
+uint32_t latency_ms[DTLS_BENCH_MESSAGES];
+
+}
+
+static void print_error(const char *name, int err)
+{
+    char buf[128];
+    mbedtls_strerror(err, buf, sizeof(buf));
+    printf("%s failed: -0x%04x: %s\r\n", name, -err, buf);
+}
+
+static int compare_u32(const void *a, const void *b)
+{
+    uint32_t x = *(const uint32_t *) a, y = *(const uint32_t *) b;
+    return x < y ? -1 : x > y;
+}
+
+static void summarize(int delivered, int lost, LatencyResult *r)
+{
+    uint64_t sum = 0;
+
+    memset(r, 0, sizeof(*r));
+    r->delivered = delivered;
+    r->lost = lost;
+    if (delivered == 0) {
+        return;
+    }
+    qsort(latency_ms, delivered, sizeof(latency_ms[0]), compare_u32);
+    for (int i = 0; i < delivered; i++) {
+        sum += latency_ms[i];
+    }
+    r->avg_ms = sum / delivered;
+    r->p95_ms = latency_ms[(delivered * 95 - 1) / 100];
+    r->max_ms = latency_ms[delivered - 1];
+}
+
+static void print_result(const char *transport, uint32_t loss, const LatencyResult &r)
+{
+    printf("%-8s %4lu%% %9d %5d %7lu %7lu %7lu\r\n", transport, (unsigned long)loss, r.delivered, r.lost,
+           (unsigned long)r.avg_ms, (unsigned long)r.p95_ms, (unsigned long)r.max_ms);
+}
+
+static int format_message(char *buf, size_t size, int seq)
+{
+    /* ssl_server2 takes a message as complete at the newline */
+    return snprintf(buf, size, "telemetry %05d t=%lu\r\n", seq, (unsigned long)us_ticker_read());
+}
+
+static void bench_dtls(DtlsClient *client, uint32_t loss, LatencyResult *r)
+{
+    char msg[64];
+    unsigned char reply[512];
+    int delivered = 0, lost = 0;
+    Timer t;
+
+    client->set_loss(loss);
+    t.start();
+    for (int seq = 0; seq < DTLS_BENCH_MESSAGES; seq++) {
+        /* A reply that missed its timeout would pass for this message's
+         * with a latency near 0 */
+        while (client->recv(reply, sizeof(reply), DTLS_BENCH_DRAIN_MS) > 0) {
+        }
+
+        int len = format_message(msg, sizeof(msg), seq);
+        t.reset();
+        int ret = client->send(msg, len);
+        if (ret < 0) {
+            print_error("DtlsClient::send", ret);
+            break;
+        }
+        ret = client->recv(reply, sizeof(reply), DTLS_BENCH_TIMEOUT_MS);
+        if (ret == MBEDTLS_ERR_SSL_TIMEOUT) {
+            lost++;
+            continue;
+        }
+        if (ret < 0) {
+            print_error("DtlsClient::recv", ret);
+            break;
+        }
+        latency_ms[delivered++] = t.read_ms();
+    }
+    client->set_loss(0);
+    summarize(delivered, lost, r);
+}
+
+static int bench_tls(NetworkInterface *net, TlsEnvironment *tls, const char *host, uint16_t port,
+                     LatencyResult *r)
+{
+    mbedtls_ssl_context ssl;
+    TCPSocket socket(net);
+    char msg[64];
+    unsigned char reply[512];
+    int delivered = 0;
+    Timer t;
+    int ret;
+
+    memset(r, 0, sizeof(*r));
+    mbedtls_ssl_init(&ssl);
+    ret = tls->setup(&ssl, host);
+    if (ret != 0) {
+        print_error("TlsEnvironment::setup", ret);
+        goto exit;
+    }
+    mbedtls_ssl_set_bio(&ssl, &socket, TlsSocketBio::send, TlsSocketBio::recv, NULL);
+
+    ret = socket.connect(host, port);
+    if (ret != 0) {
+        printf("TCP connect to %s:%u failed: %d\r\n", host, port, ret);
+        goto exit;
+    }
+    do {
+        ret = mbedtls_ssl_handshake(&ssl);
+    } while (ret == MBEDTLS_ERR_SSL_WANT_READ || ret == MBEDTLS_ERR_SSL_WANT_WRITE);
+    if (ret != 0) {
+        print_error("mbedtls_ssl_handshake", ret);
+        goto close;
+    }
+
+    /* TCP delivers every message, late rather than never */
+    t.start();
+    for (int seq = 0; seq < DTLS_BENCH_MESSAGES; seq++) {
+        int len = format_message(msg, sizeof(msg), seq);
+        t.reset();
+        do {
+            ret = mbedtls_ssl_write(&ssl, (const unsigned char *) msg, len);
+        } while (ret == MBEDTLS_ERR_SSL_WANT_READ || ret == MBEDTLS_ERR_SSL_WANT_WRITE);
+        if (ret < 0) {
+            print_error("mbedtls_ssl_write", ret);
+            break;
+        }
+        do {
+            ret = mbedtls_ssl_read(&ssl, reply, sizeof(reply));
+        } while (ret == MBEDTLS_ERR_SSL_WANT_READ || ret == MBEDTLS_ERR_SSL_WANT_WRITE);
+        if (ret <= 0) {
+            print_error("mbedtls_ssl_read", ret);
+            break;
+        }
+        latency_ms[delivered++] = t.read_ms();
+    }
+    ret = 0;
+    mbedtls_ssl_close_notify(&ssl);
+
+close:
+    socket.close();
+exit:
+    mbedtls_ssl_free(&ssl);
+    summarize(delivered, DTLS_BENCH_MESSAGES - delivered, r);
+    return ret;
+}
+
+int app_dtls_bench()
+{
+    EMW10xxInterface wifi_iface;
+    LatencyResult result;
+
+#if defined(MBED_CONF_APP_DTLS_BENCH_HOST)
+    const char *host = MBED_CONF_APP_DTLS_BENCH_HOST;
+#else
+    const char *host = NULL;
+#endif
+    if (!host) {
+        printf("Set dtls-bench-host in mbed_app.json to the DTLS and TLS servers\r\n");
+        return -1;
+    }
+#if !defined(MBEDTLS_SSL_PROTO_DTLS)
+    printf("This mbed TLS build has no DTLS (MBEDTLS_SSL_PROTO_DTLS)\r\n");
+    return -1;
+#else
+    const uint16_t port = MBED_CONF_APP_DTLS_BENCH_PORT;
+
+    int ret = wifi_iface.connect(MBED_CONF_APP_WIFI_SSID, MBED_CONF_APP_WIFI_PASSWORD, NSAPI_SECURITY_WPA_WPA2, 0);
+    if (ret != 0) {
+        printf("\r\nConnection error\r\n");
+        return -1;
+    }
+    printf("IP: %s, servers %s:%u UDP and TCP\r\n", wifi_iface.get_ip_address(), host, port);
+
+    /* The test servers have throwaway certificates, no CA chain is loaded */
+    TlsEnvironment *dtls_env = new TlsEnvironment();
+    TlsEnvironment *tls_env = new TlsEnvironment();
+    TlsSessionCache *sessions = new TlsSessionCache();
+    DnsCache *dns = new DnsCache(&wifi_iface);
+    DtlsClient *client = NULL;
+
+    ret = dtls_env->init(NULL, 0, DRBG_PERS, MBEDTLS_SSL_TRANSPORT_DATAGRAM);
+    if (ret == 0) {
+        ret = tls_env->init(NULL, 0, DRBG_PERS);
+    }
+    if (ret != 0) {
+        print_error("TlsEnvironment::init", ret);
+        goto exit;
+    }
+    mbedtls_ssl_conf_authmode(dtls_env->config(), MBEDTLS_SSL_VERIFY_NONE);
+    mbedtls_ssl_conf_authmode(tls_env->config(), MBEDTLS_SSL_VERIFY_NONE);
+    mbedtls_ssl_conf_handshake_timeout(dtls_env->config(), DTLS_BENCH_HS_MIN_MS, DTLS_BENCH_HS_MAX_MS);
+    TlsSessionCache::enable_tickets(dtls_env->config());
+
+    /* A full handshake, then one resuming its session as after an address change */
+    client = new DtlsClient(dtls_env, sessions);
+    for (int i = 0; i < 2; i++) {
+        ret = client->connect(&wifi_iface, host, port, dns);
+        if (ret != 0) {
+            print_error("DtlsClient::connect", ret);
+            goto exit;
+        }
+        printf("DTLS handshake: %lu ms, %s%s\r\n", (unsigned long)client->handshake_ms(),
+               client->resumed() ? "resumed" : "full", client->cookie_exchanged() ? ", cookie exchanged" : "");
+        if (i == 0) {
+            client->close();
+        }
+    }
+
+    printf("\r\n%d messages, %lu ms until lost\r\n", DTLS_BENCH_MESSAGES, (unsigned long)DTLS_BENCH_TIMEOUT_MS);
+    printf("%-8s %5s %9s %5s %7s %7s %7s\r\n", "", "loss", "delivered", "lost", "avg ms", "p95 ms", "max ms");
+    for (int i = 0; i < LOSS_STEPS; i++) {
+        bench_dtls(client, loss_percent[i], &result);
+        print_result("DTLS", loss_percent[i], result);
+    }
+
+    if (bench_tls(&wifi_iface, tls_env, host, port, &result) == 0) {
+        print_result("TLS/TCP", 0, result);
+    }
+
+    client->print_stats("\r\nDTLS");
+    sessions->print_stats("DTLS sessions");
+
+exit:
+    delete client;
+    delete dns;
+    delete sessions;
+    delete tls_env;
+    delete dtls_env;
+    wifi_iface.disconnect();
+    return ret;
+#endif
+}
@@ -0,0 +1,274 @@
+/* ECC benchmark
+ * Copyright (c) 2017 MXCHIP Information Tech. Co.,Ltd
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/** \file ecc_bench_main.cpp
+ *  \brief Time the P-256 operations of an ECDHE-ECDSA handshake under the
+ *  tls-crypto-profile this image was built with, and the stack they need.
+ *
+ *  ECDH and ECDSA verify are timed twice: on a group loaded once, where the
+ *  fixed-point table is built on the first use only, and on a group loaded
+ *  per operation as TLS does it for each key exchange and certificate. The client side of a handshake verifies two signatures
+ *  (certificate and ServerKeyExchange) and runs one ECDH key generation and
+ *  one shared secret computation; their sum is compared to the 1 s budget.
+ *  No network is needed.
+ */
+
+#include "mbed.h"
+
+#include "mbedtls/ecdh.h"
+#include "mbedtls/ecdsa.h"
+#include "mbedtls/entropy.h"
+#include "mbedtls/ctr_drbg.h"
+#include "mbedtls/error.h"
+
+namespace {
+
+const int ECC_BENCH_ROUNDS = 5;
+
+/* The bench runs on its own thread so its stack peak can be read */
+const uint32_t ECC_BENCH_STACK = 8192;
+
+const uint32_t HANDSHAKE_BUDGET_MS = 1000;
+
+const char *DRBG_PERS = "ecc bench";
+
+enum EccOp {
+    OP_ECDH_GEN,
+    OP_ECDH_SHARED,
+    OP_ECDH_FRESH_GROUP,
+    OP_ECDSA_SIGN,
+    OP_ECDSA_VERIFY,
+    OP_ECDSA_VERIFY_FRESH_GROUP,
+    OP_COUNT
+};
+
+const char *const op_names[OP_COUNT] = {
+    "ECDH key generation",
+    "ECDH shared secret",
+    "ECDH gen + shared, new group",
+    "ECDSA sign",
+    "ECDSA verify",
+    "ECDSA verify, new group",
+};
+
+uint32_t op_us[OP_COUNT];
+int bench_error;
+uint32_t bench_stack;
+
+mbedtls_entropy_context entropy;
+mbedtls_ctr_drbg_context ctr_drbg;
+
+}
+
+static void print_error(const char *name, int err)
+{
+    char buf[128];
+    mbedtls_strerror(err, buf, sizeof(buf));
+    printf("%s failed: -0x%04x: %s\r\n", name, -err, buf);
+}
+
+static int bench_ecdh()
+{
+    mbedtls_ecp_group grp;
+    mbedtls_mpi d_a, d_b, z;
+    mbedtls_ecp_point q_a, q_b;
+    Timer t;
+    int ret;
+
+    mbedtls_ecp_group_init(&grp);
+    mbedtls_mpi_init(&d_a);
+    mbedtls_mpi_init(&d_b);
+    mbedtls_mpi_init(&z);
+    mbedtls_ecp_point_init(&q_a);
+    mbedtls_ecp_point_init(&q_b);
+
+    ret = mbedtls_ecp_group_load(&grp, MBEDTLS_ECP_DP_SECP256R1);
+    if (ret != 0) {
+        print_error("mbedtls_ecp_group_load", ret);
+        goto exit;
+    }
+    /* The peer's key, not timed. Also builds the fixed-point table */
+    ret = mbedtls_ecdh_gen_public(&grp, &d_b, &q_b, mbedtls_ctr_drbg_random, &ctr_drbg);
+    if (ret != 0) {
+        print_error("mbedtls_ecdh_gen_public", ret);
+        goto exit;
+    }
+
+    t.start();
+    for (int i = 0; i < ECC_BENCH_ROUNDS; i++) {
+        t.reset();
+        ret = mbedtls_ecdh_gen_public(&grp, &d_a, &q_a, mbedtls_ctr_drbg_random, &ctr_drbg);
+        op_us[OP_ECDH_GEN] += t.read_us();
+        if (ret != 0) {
+            print_error("mbedtls_ecdh_gen_public", ret);
+            goto exit;
+        }
+
+        t.reset();
+        ret = mbedtls_ecdh_compute_shared(&grp, &z, &q_b, &d_a, mbedtls_ctr_drbg_random, &ctr_drbg);
+        op_us[OP_ECDH_SHARED] += t.read_us();
+        if (ret != 0) {
+            print_error("mbedtls_ecdh_compute_shared", ret);
+            goto exit;
+        }
+    }
+
+    /* As in a TLS handshake: load the curve, generate, compute, free */
+    for (int i = 0; i < ECC_BENCH_ROUNDS; i++) {
+        mbedtls_ecp_group fresh;
+        mbedtls_ecp_group_init(&fresh);
+
+        t.reset();
+        ret = mbedtls_ecp_group_load(&fresh, MBEDTLS_ECP_DP_SECP256R1);
+        if (ret == 0) {
+            ret = mbedtls_ecdh_gen_public(&fresh, &d_a, &q_a, mbedtls_ctr_drbg_random, &ctr_drbg);
+        }
+        if (ret == 0) {
+            ret = mbedtls_ecdh_compute_shared(&fresh, &z, &q_b, &d_a, mbedtls_ctr_drbg_random, &ctr_drbg);
+        }
+        op_us[OP_ECDH_FRESH_GROUP] += t.read_us();
+        mbedtls_ecp_group_free(&fresh);
+        if (ret != 0) {
+            print_error("ECDH on a new group", ret);
+            goto exit;
+        }
+    }
+
+exit:
+    mbedtls_ecp_point_free(&q_b);
+    mbedtls_ecp_point_free(&q_a);
+    mbedtls_mpi_free(&z);
+    mbedtls_mpi_free(&d_b);
+    mbedtls_mpi_free(&d_a);
+    mbedtls_ecp_group_free(&grp);
+    return ret;
+}
+
+static int bench_ecdsa()
+{
+    mbedtls_ecdsa_context key;
+    unsigned char hash[32];
+    unsigned char sig[MBEDTLS_ECDSA_MAX_LEN];
+    size_t sig_len;
+    Timer t;
+    int ret;
+
+    mbedtls_ecdsa_init(&key);
+    memset(hash, 0x2A, sizeof(hash));
+
+    ret = mbedtls_ecdsa_genkey(&key, MBEDTLS_ECP_DP_SECP256R1, mbedtls_ctr_drbg_random, &ctr_drbg);
+    if (ret != 0) {
+        print_error("mbedtls_ecdsa_genkey", ret);
+        goto exit;
+    }
+
+    t.start();
+    for (int i = 0; i < ECC_BENCH_ROUNDS; i++) {
+        t.reset();
+        ret = mbedtls_ecdsa_write_signature(&key, MBEDTLS_MD_SHA256, hash, sizeof(hash),
+                                            sig, &sig_len, mbedtls_ctr_drbg_random, &ctr_drbg);
+        op_us[OP_ECDSA_SIGN] += t.read_us();
+        if (ret != 0) {
+            print_error("mbedtls_ecdsa_write_signature", ret);
+            goto exit;
+        }
+
+        t.reset();
+        ret = mbedtls_ecdsa_read_signature(&key, hash, sizeof(hash), sig, sig_len);
+        op_us[OP_ECDSA_VERIFY] += t.read_us();
+        if (ret != 0) {
+            print_error("mbedtls_ecdsa_read_signature", ret);
+            goto exit;
+        }
+
+        /* As in a TLS handshake: each parsed public key loads its curve */
+        mbedtls_ecdsa_context fresh;
+        mbedtls_ecdsa_init(&fresh);
+        t.reset();
+        ret = mbedtls_ecp_group_load(&fresh.grp, MBEDTLS_ECP_DP_SECP256R1);
+        if (ret == 0) {
+            ret = mbedtls_ecp_copy(&fresh.Q, &key.Q);
+        }
+        if (ret == 0) {
+            ret = mbedtls_ecdsa_read_signature(&fresh, hash, sizeof(hash), sig, sig_len);
+        }
+        op_us[OP_ECDSA_VERIFY_FRESH_GROUP] += t.read_us();
+        mbedtls_ecdsa_free(&fresh);
+        if (ret != 0) {
+            print_error("ECDSA verify on a new group", ret);
+            goto exit;
+        }
+    }
+
+exit:
+    mbedtls_ecdsa_free(&key);
+    return ret;
+}
+
+static void bench_thread(Thread *self)
+{
+    bench_error = bench_ecdh();
+    if (bench_error == 0) {
+        bench_error = bench_ecdsa();
+    }
+    /* The stack of a finished thread is gone, read it while running */
+    bench_stack = self->max_stack();
+}
+
+static uint32_t avg_ms(EccOp op)
+{
+    return op_us[op] / ECC_BENCH_ROUNDS / 1000;
+}
+
+int app_ecc_bench()
+{
+#if defined(TLS_CRYPTO_PROFILE_NAME)
+    printf("\r\nECC bench, crypto profile: %s\r\n", TLS_CRYPTO_PROFILE_NAME);
+#endif
+    printf("CPU %lu MHz, %d rounds each\r\n", (unsigned long)(SystemCoreClock / 1000000), ECC_BENCH_ROUNDS);
+
+    mbedtls_entropy_init(&entropy);
+    mbedtls_ctr_drbg_init(&ctr_drbg);
+    int ret = mbedtls_ctr_drbg_seed(&ctr_drbg, mbedtls_entropy_func, &entropy,
+                                    (const unsigned char *) DRBG_PERS, strlen(DRBG_PERS));
+    if (ret != 0) {
+        print_error("mbedtls_ctr_drbg_seed", ret);
+        return -1;
+    }
+
+    Thread thread(osPriorityNormal, ECC_BENCH_STACK);
+    thread.start(callback(bench_thread, &thread));
+    thread.join();
+
+    mbedtls_ctr_drbg_free(&ctr_drbg);
+    mbedtls_entropy_free(&entropy);
+    if (bench_error != 0) {
+        return -1;
+    }
+
+    for (int op = 0; op < OP_COUNT; op++) {
+        printf("%-30s %6lu ms\r\n", op_names[op], (unsigned long)avg_ms((EccOp)op));
+    }
+    printf("Peak stack: %lu of %lu bytes\r\n",
+           (unsigned long)bench_stack, (unsigned long)ECC_BENCH_STACK);
+
+    /* Client public key work of one ECDHE-ECDSA handshake */
+    uint32_t handshake_ms = 2 * avg_ms(OP_ECDSA_VERIFY_FRESH_GROUP) + avg_ms(OP_ECDH_FRESH_GROUP);
+    printf("Handshake public key work: ~%lu ms, %s the %lu ms budget\r\n",
+           (unsigned long)handshake_ms, handshake_ms < HANDSHAKE_BUDGET_MS ? "within" : "over",
+           (unsigned long)HANDSHAKE_BUDGET_MS);
+    return 0;
+}
@@ -17,6 +17,8 @@
 #include "mbed.h"
 #include "UDPSocket.h"
 #include "EMW10xxInterface.h"
+#include "TCPStreamWriter.h"
+#include "us_ticker_api.h"
 
 const SocketAddress udp_server( "172.16.0.181", 10000 );
 
@@ -25,16 +27,181 @@ const int ECHO_SERVER_PORT = 7;
 const int BUFFER_SIZE = 4096;
 char buffer[BUFFER_SIZE] = {0};
 
-void tcp_send( TCPSocket *tcp, const void *data, nsapi_size_t size )
+/* UDP echo server: clients tracked for statistics, and the report period */
+const int ECHO_MAX_CLIENTS = 8;
+const int ECHO_REPORT_MS = 10000;
+
+/* Longest wait for a full socket to take an echo before it counts as an error */
+const int ECHO_SEND_WAIT_MS = 100;
+
+/* Datagrams read before they are echoed back to back, from echo-batch in
+ * mbed_app.json. 1 echoes each one at once for the lowest turnaround.
+ * More means fewer switches between reading and sending under bursts, at
+ * the cost of turnaround. Each datagram of a batch gets BUFFER_SIZE / batch
+ * bytes of the buffer, and a longer one comes back truncated. */
+#if defined(MBED_CONF_APP_ECHO_BATCH)
+const int ECHO_BATCH = MBED_CONF_APP_ECHO_BATCH;
+#else
+const int ECHO_BATCH = 1;
+#endif
+const int ECHO_SLOT_SIZE = BUFFER_SIZE / ECHO_BATCH;
+
+struct echo_client_t {
+    SocketAddress addr;
+    uint32_t packets;
+    uint32_t bytes;
+    uint32_t errors;
+    uint64_t turnaround_us;     /* recvfrom() return to sendto() return, summed */
+    uint32_t turnaround_max_us;
+};
+
+struct echo_datagram_t {
+    SocketAddress peer;
+    nsapi_size_t len;
+    uint32_t rx_us;
+};
+
+static echo_client_t echo_clients[ECHO_MAX_CLIENTS];
+static int echo_client_num = 0;
+static echo_datagram_t echo_batch[ECHO_BATCH];
+static Semaphore echo_sigio( 0 );
+
+static void echo_on_sigio( )
 {
-    nsapi_size_t remain = size;
-    uint8_t *data_tmp = (uint8_t *)data;
+    echo_sigio.release( );
+}
 
-    while( remain )
-    {
-        remain -= tcp->send( data_tmp, remain );
-        data_tmp = (uint8_t *)data + size - remain;
+static echo_client_t *echo_find_client( const SocketAddress &addr, echo_client_t *last )
+{
+    /* Most traffic comes from the client we saw last */
+    if ( last && last->addr == addr && last->addr.get_port( ) == addr.get_port( ) ) {
+        return last;
+    }
+
+    for ( int i = 0; i < echo_client_num; i++ ) {
+        if ( echo_clients[i].addr == addr && echo_clients[i].addr.get_port( ) == addr.get_port( ) ) {
+            return &echo_clients[i];
+        }
+    }
+
+    if ( echo_client_num == ECHO_MAX_CLIENTS ) {
+        return NULL;
+    }
+
+    echo_client_t *client = &echo_clients[echo_client_num++];
+    *client = echo_client_t( );
+    client->addr = addr;
+    printf( "New client %s:%d\r\n", addr.get_ip_address( ), addr.get_port( ) );
+    return client;
+}
+
+static void echo_print_stats( void )
+{
+    printf( "\r\nUDP echo clients:\r\n" );
+    for ( int i = 0; i < echo_client_num; i++ ) {
+        echo_client_t *c = &echo_clients[i];
+        printf( "  %s:%d  %lu pkts, %lu bytes, %lu errors, turnaround avg %lu us max %lu us\r\n",
+                c->addr.get_ip_address( ), c->addr.get_port( ), (unsigned long) c->packets,
+                (unsigned long) c->bytes, (unsigned long) c->errors,
+                (unsigned long) (c->packets ? c->turnaround_us / c->packets : 0),
+                (unsigned long) c->turnaround_max_us );
+    }
+}
+
+static nsapi_size_or_error_t echo_send( UDPSocket &sock, const SocketAddress &peer, const char *data, nsapi_size_t len )
+{
+    uint32_t start_us = us_ticker_read( );
+    nsapi_size_or_error_t sent;
+
+    /* A burst fills the socket, wait until it is writable again instead of losing the echo */
+    while ( true ) {
+        sent = sock.sendto( peer, data, len );
+        if ( (sent != NSAPI_ERROR_WOULD_BLOCK && sent != NSAPI_ERROR_NO_MEMORY)
+             || us_ticker_read( ) - start_us >= ECHO_SEND_WAIT_MS * 1000 ) {
+            return sent;
+        }
+        echo_sigio.wait( ECHO_SEND_WAIT_MS );
+    }
+}
+
+/* Reflect every datagram on ECHO_SERVER_PORT back to its sender */
+int app_echo_udp_server( )
+{
+    EMW10xxInterface wifi_iface;
+    UDPSocket sock;
+    echo_client_t *client = NULL;
+    uint32_t tx_us, last_report_us;
+    nsapi_size_or_error_t n = 0, sent;
+    int count;
+
+    int ret = wifi_iface.connect( MBED_CONF_APP_WIFI_SSID, MBED_CONF_APP_WIFI_PASSWORD, NSAPI_SECURITY_WPA_WPA2, 0 );
+    if ( ret != 0 ) {
+        printf( "\r\nConnection error\r\n" );
+        return -1;
+    }
+
+    sock.open( &wifi_iface );
+    if ( sock.bind( ECHO_SERVER_PORT ) != NSAPI_ERROR_OK ) {
+        printf( "\r\nBind to port %d failed\r\n", ECHO_SERVER_PORT );
+        return -1;
     }
+    printf( "UDP echo server on %s:%d\r\n", wifi_iface.get_ip_address( ), ECHO_SERVER_PORT );
+
+    /* Drain every queued datagram before sleeping on sigio, so bursts are echoed back to back */
+    sock.set_blocking( false );
+    sock.sigio( callback( echo_on_sigio ) );
+    last_report_us = us_ticker_read( );
+
+    while ( true ) {
+        /* Checked on every pass, a flood that never empties the socket still reports */
+        if ( us_ticker_read( ) - last_report_us >= ECHO_REPORT_MS * 1000 ) {
+            echo_print_stats( );
+            last_report_us = us_ticker_read( );
+        }
+
+        for ( count = 0; count < ECHO_BATCH; count++ ) {
+            echo_datagram_t *d = &echo_batch[count];
+            n = sock.recvfrom( &d->peer, buffer + count * ECHO_SLOT_SIZE, ECHO_SLOT_SIZE );
+            if ( n < 0 ) {
+                break;
+            }
+            d->len = n;
+            d->rx_us = us_ticker_read( );
+        }
+
+        for ( int i = 0; i < count; i++ ) {
+            echo_datagram_t *d = &echo_batch[i];
+            sent = echo_send( sock, d->peer, buffer + i * ECHO_SLOT_SIZE, d->len );
+            tx_us = us_ticker_read( );
+
+            client = echo_find_client( d->peer, client );
+            if ( client != NULL && sent != (nsapi_size_or_error_t) d->len ) {
+                client->errors++;
+            } else if ( client != NULL ) {
+                client->packets++;
+                client->bytes += d->len;
+                client->turnaround_us += tx_us - d->rx_us;
+                if ( tx_us - d->rx_us > client->turnaround_max_us ) {
+                    client->turnaround_max_us = tx_us - d->rx_us;
+                }
+            }
+        }
+
+        if ( count == ECHO_BATCH ) {
+            continue;
+        }
+        if ( n != NSAPI_ERROR_WOULD_BLOCK ) {
+            printf( "recvfrom error %d\r\n", n );
+            break;
+        }
+        if ( count == 0 ) {
+            echo_sigio.wait( ECHO_REPORT_MS );
+        }
+    }
+
+    echo_print_stats( );
+    sock.close( );
+    return 0;
 }
 
 void app_mbed_tcp_udp( )
@@ -64,10 +231,26 @@ void app_mbed_tcp_udp( )
 //        //udpsocket.sendto( SocketAddress("10.0.3.10", 10000), buffer, BUFFER_SIZE );
 //    }
 
+    TCPStreamWriter writer( &tcpsocket, true );
+    Timer report;
+    report.start( );
+
     while(1)
     {
-        tcp_send( &tcpsocket, buffer, BUFFER_SIZE );
+        ns_ret = writer.write( buffer, BUFFER_SIZE );
+        if ( ns_ret != NSAPI_ERROR_OK ) {
+            printf( "\r\n TCP send error %d\r\n", ns_ret );
+            break;
+        }
+
+        if ( report.read_ms( ) >= 10000 ) {
+            writer.print_stats( "TCP flood" );
+            report.reset( );
+        }
     }
+
+    writer.print_stats( "TCP flood" );
+    tcpsocket.close( );
 }
 
 
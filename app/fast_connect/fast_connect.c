@@ -0,0 +1,439 @@
+/* MiCO Team
+ * Copyright (c) 2017 MXCHIP Information Tech. Co.,Ltd
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <time.h>
+
+#include "mico.h"
+#include "lwip/tcpip.h"
+#include "lwip/netif.h"
+#include "lwip/etharp.h"
+
+#include "fast_connect.h"
+
+#define fast_connect_log(M, ...) custom_log("FastConnect", M, ##__VA_ARGS__)
+
+/******************************************************
+ *                    Structures
+ ******************************************************/
+
+/* One step of the ARP check, run in the tcpip thread: the ARP table of
+ * lwIP is not thread safe */
+typedef struct fast_connect_arp_s
+{
+    ip_addr_t own;
+    ip_addr_t gateway;
+    bool check_own;     /* look for another holder of "own" */
+    bool flush;         /* drop the entries of the last wake first */
+    bool send;          /* send the requests before looking */
+    bool gateway_found;
+    bool own_taken;
+    mico_semaphore_t done;
+} fast_connect_arp_t;
+
+/******************************************************
+ *               Variables Definitions
+ ******************************************************/
+
+static mico_semaphore_t connect_sem = NULL;
+static uint32_t connect_start;
+static volatile uint32_t associated_at;
+static volatile uint32_t ip_at;
+static volatile bool static_ip;
+static bool lease_reuse = true;
+static bool gateway_probe = false;
+
+/* Stored record, updated by the notifications of the current connect */
+static fast_connect_record_t pending;
+
+/******************************************************
+ *               Function Definitions
+ ******************************************************/
+
+static uint32_t fast_connect_hash( const void *data, uint32_t len )
+{
+    const uint8_t *p = (const uint8_t *) data;
+    uint32_t hash = 2166136261UL; /* FNV-1a */
+
+    while ( len-- ) {
+        hash = (hash ^ *p++) * 16777619UL;
+    }
+    return hash;
+}
+
+static OSStatus fast_connect_load( fast_connect_record_t *record )
+{
+    uint32_t offset = 0;
+    OSStatus err;
+
+    err = MicoFlashRead( FAST_CONNECT_PARTITION, &offset, (uint8_t *) record, sizeof(*record) );
+    require_noerr( err, exit );
+
+    require_action( record->magic == FAST_CONNECT_MAGIC, exit, err = kNotFoundErr );
+    require_action( record->checksum == fast_connect_hash( record, offsetof(fast_connect_record_t, checksum) ),
+                    exit, err = kNotFoundErr );
+
+exit:
+    return err;
+}
+
+static OSStatus fast_connect_save( fast_connect_record_t *record )
+{
+    uint32_t offset = 0;
+    OSStatus err;
+
+    record->magic = FAST_CONNECT_MAGIC;
+    record->checksum = fast_connect_hash( record, offsetof(fast_connect_record_t, checksum) );
+
+    err = MicoFlashErase( FAST_CONNECT_PARTITION, 0, sizeof(*record) );
+    require_noerr( err, exit );
+    err = MicoFlashWrite( FAST_CONNECT_PARTITION, &offset, (uint8_t *) record, sizeof(*record) );
+
+exit:
+    return err;
+}
+
+OSStatus fast_connect_forget( void )
+{
+    return MicoFlashErase( FAST_CONNECT_PARTITION, 0, sizeof(fast_connect_record_t) );
+}
+
+static void fast_connect_check_done( void )
+{
+    if ( associated_at && ip_at ) {
+        mico_rtos_set_semaphore( &connect_sem );
+    }
+}
+
+static void fast_connect_wifi_status_handler( WiFiEvent status, void* const inContext )
+{
+    if ( status == NOTIFY_STATION_UP && !associated_at ) {
+        associated_at = mico_rtos_get_time( );
+        /* No DHCP to wait for, the address is set with the link */
+        if ( static_ip ) {
+            ip_at = associated_at;
+        }
+        fast_connect_check_done( );
+    }
+}
+
+static void fast_connect_para_changed_handler( apinfo_adv_t *ap_info, char *key, int key_len, void* const inContext )
+{
+    strncpy( pending.ssid, ap_info->ssid, sizeof(pending.ssid) - 1 );
+    memcpy( pending.bssid, ap_info->bssid, sizeof(pending.bssid) );
+    pending.channel = ap_info->channel;
+    pending.security = ap_info->security;
+    pending.key_len = key_len < (int) sizeof(pending.key) - 1 ? key_len : sizeof(pending.key) - 1;
+    memcpy( pending.key, key, pending.key_len );
+    pending.key[pending.key_len] = 0;
+}
+
+/* The RTC keeps counting through standby, so it dates the lease across
+ * wakes whether or not it was ever set to the real time. The UTC clock of
+ * MiCO starts over at every boot and is only set by SNTP. */
+static uint32_t fast_connect_rtc_s( void )
+{
+    time_t now = time( NULL );
+    return now == (time_t) -1 ? 0 : (uint32_t) now;
+}
+
+static void fast_connect_dhcp_handler( IPStatusTypedef *pnet, void* const inContext )
+{
+    if ( static_ip ) {
+        return;
+    }
+
+    /* 0 means unknown, a lease taken in the first RTC second is just not reused */
+    pending.lease_obtained = fast_connect_rtc_s( );
+    strncpy( pending.ip, pnet->ip, sizeof(pending.ip) - 1 );
+    strncpy( pending.gateway, pnet->gate, sizeof(pending.gateway) - 1 );
+    strncpy( pending.netmask, pnet->mask, sizeof(pending.netmask) - 1 );
+    strncpy( pending.dns, pnet->dns, sizeof(pending.dns) - 1 );
+
+    if ( !ip_at ) {
+        ip_at = mico_rtos_get_time( );
+        fast_connect_check_done( );
+    }
+}
+
+OSStatus fast_connect_init( void )
+{
+    OSStatus err = kNoErr;
+
+    if ( connect_sem ) {
+        return kNoErr;
+    }
+    mico_rtos_init_semaphore( &connect_sem, 1 );
+
+    err = mico_system_notify_register( mico_notify_WIFI_STATUS_CHANGED,
+                                       (void *) fast_connect_wifi_status_handler, NULL );
+    require_noerr( err, exit );
+    err = mico_system_notify_register( mico_notify_WiFI_PARA_CHANGED,
+                                       (void *) fast_connect_para_changed_handler, NULL );
+    require_noerr( err, exit );
+    err = mico_system_notify_register( mico_notify_DHCP_COMPLETED,
+                                       (void *) fast_connect_dhcp_handler, NULL );
+
+exit:
+    return err;
+}
+
+void fast_connect_set_lease_reuse( bool enable )
+{
+    lease_reuse = enable;
+}
+
+static bool fast_connect_lease_fresh( const fast_connect_record_t *record )
+{
+    uint32_t now;
+
+    if ( !record->lease_obtained || !record->ip[0] ) {
+        return false;
+    }
+
+    /* An RTC behind the record was reset by a power loss, the age is unknown */
+    now = fast_connect_rtc_s( );
+    if ( now < record->lease_obtained ) {
+        return false;
+    }
+    return now - record->lease_obtained < FAST_CONNECT_LEASE_S / 2;
+}
+
+static bool fast_connect_lease_valid( const fast_connect_record_t *record )
+{
+    return lease_reuse && fast_connect_lease_fresh( record );
+}
+
+void fast_connect_set_gateway_probe( bool enable )
+{
+    gateway_probe = enable;
+}
+
+static void fast_connect_arp_step( void *arg )
+{
+    fast_connect_arp_t *arp = (fast_connect_arp_t *) arg;
+    struct eth_addr *eth_ret;
+    ip_addr_t *ip_ret;
+
+    if ( arp->flush ) {
+        etharp_cleanup_netif( netif_default );
+    }
+    if ( arp->send ) {
+        if ( arp->check_own ) {
+            etharp_request( netif_default, &arp->own );
+        }
+        etharp_request( netif_default, &arp->gateway );
+    }
+    arp->gateway_found = etharp_find_addr( netif_default, &arp->gateway, &eth_ret, &ip_ret ) >= 0;
+    arp->own_taken = arp->check_own && etharp_find_addr( netif_default, &arp->own, &eth_ret, &ip_ret ) >= 0;
+    mico_rtos_set_semaphore( &arp->done );
+}
+
+/*
+ * Resolve the gateway with ARP and, if "own" is given, ask for that address
+ * too. lwIP only sends ARP from the configured address (etharp_raw() is
+ * private without AUTOIP), so this is a request for our own address rather
+ * than an RFC 5227 probe from 0.0.0.0. A host holding the address answers
+ * it, and the answer lands in the ARP table. It answers about as fast as
+ * the gateway, so the check ends with the gateway's answer.
+ */
+static OSStatus fast_connect_arp_probe( const char *own, const char *gateway, uint32_t *answered_at )
+{
+    fast_connect_arp_t arp;
+    uint32_t start = mico_rtos_get_time( );
+    uint32_t elapsed, next_send = 0;
+    OSStatus err = kTimeoutErr;
+
+    memset( &arp, 0, sizeof(arp) );
+    arp.check_own = (own != NULL);
+    if ( own ) {
+        ip4_addr_set_u32( &arp.own, inet_addr( own ) );
+    }
+    ip4_addr_set_u32( &arp.gateway, inet_addr( gateway ) );
+    arp.flush = true;
+    mico_rtos_init_semaphore( &arp.done, 1 );
+
+    for ( elapsed = 0; elapsed < FAST_CONNECT_ARP_TIMEOUT_MS; elapsed = mico_rtos_get_time( ) - start ) {
+        /* Requests and answers get lost right after association, ask again */
+        arp.send = (elapsed >= next_send);
+        if ( arp.send ) {
+            next_send += FAST_CONNECT_ARP_RETRY_MS;
+        }
+        if ( tcpip_callback( fast_connect_arp_step, &arp ) != ERR_OK ) {
+            err = kNoResourcesErr;
+            break;
+        }
+        mico_rtos_get_semaphore( &arp.done, MICO_WAIT_FOREVER );
+        arp.flush = false;
+
+        if ( arp.own_taken ) {
+            err = kAlreadyInUseErr;
+            break;
+        }
+        if ( arp.gateway_found ) {
+            *answered_at = mico_rtos_get_time( );
+            err = kNoErr;
+            break;
+        }
+        mico_thread_msleep( FAST_CONNECT_ARP_POLL_MS );
+    }
+
+    mico_rtos_deinit_semaphore( &arp.done );
+    return err;
+}
+
+static void fast_connect_fill_conf( network_InitTypeDef_adv_st *conf, const fast_connect_record_t *record,
+                                    bool use_lease )
+{
+    /* Directed: known BSSID and channel, PMK instead of the passphrase */
+    memset( conf, 0, sizeof(*conf) );
+    strncpy( conf->ap_info.ssid, record->ssid, sizeof(conf->ap_info.ssid) );
+    memcpy( conf->ap_info.bssid, record->bssid, sizeof(conf->ap_info.bssid) );
+    conf->ap_info.channel = record->channel;
+    conf->ap_info.security = (wlan_sec_type_t) record->security;
+    memcpy( conf->key, record->key, record->key_len );
+    conf->key_len = record->key_len;
+    conf->wifi_retry_interval = 100;
+
+    if ( use_lease ) {
+        conf->dhcpMode = DHCP_Disable;
+        strncpy( conf->local_ip_addr, record->ip, sizeof(conf->local_ip_addr) );
+        strncpy( conf->gateway_ip_addr, record->gateway, sizeof(conf->gateway_ip_addr) );
+        strncpy( conf->net_mask, record->netmask, sizeof(conf->net_mask) );
+        strncpy( conf->dnsServer_ip_addr, record->dns, sizeof(conf->dnsServer_ip_addr) );
+    } else {
+        conf->dhcpMode = DHCP_Client;
+    }
+}
+
+static OSStatus fast_connect_attempt( network_InitTypeDef_adv_st *conf, uint32_t timeout_ms )
+{
+    associated_at = 0;
+    ip_at = 0;
+    static_ip = (conf->dhcpMode == DHCP_Disable);
+    /* Drop a wake-up left over from an earlier attempt */
+    while ( mico_rtos_get_semaphore( &connect_sem, 0 ) == kNoErr ) {
+    }
+
+    micoWlanStartAdv( conf );
+    if ( mico_rtos_get_semaphore( &connect_sem, timeout_ms ) != kNoErr ) {
+        micoWlanSuspendStation( );
+        return kTimeoutErr;
+    }
+    return kNoErr;
+}
+
+OSStatus fast_connect( const char *ssid, const char *passphrase, fast_connect_timing_t *timing )
+{
+    OSStatus err;
+    network_InitTypeDef_adv_st conf;
+    fast_connect_record_t stored;
+    fast_connect_timing_t t;
+    uint32_t pass_hash = fast_connect_hash( passphrase, strlen( passphrase ) );
+    uint32_t arp_at = 0;
+    OSStatus probe_err;
+    bool have_record;
+    bool lease_renewed;
+
+    require_action( connect_sem, exit, err = kNotInitializedErr );
+
+    memset( &t, 0, sizeof(t) );
+    connect_start = mico_rtos_get_time( );
+
+    have_record = fast_connect_load( &stored ) == kNoErr
+                  && strcmp( stored.ssid, ssid ) == 0
+                  && stored.pass_hash == pass_hash;
+    memset( &pending, 0, sizeof(pending) );
+
+    if ( have_record ) {
+        pending = stored;
+        t.lease_reused = fast_connect_lease_valid( &stored );
+
+        fast_connect_log( "directed connect to %s, channel %d%s", stored.ssid, stored.channel,
+                          t.lease_reused ? ", reusing lease" : "" );
+        fast_connect_fill_conf( &conf, &stored, t.lease_reused );
+        err = fast_connect_attempt( &conf, FAST_CONNECT_DIRECTED_TIMEOUT_MS );
+
+        if ( err == kNoErr && t.lease_reused ) {
+            probe_err = fast_connect_arp_probe( stored.ip, stored.gateway, &arp_at );
+            if ( probe_err != kNoErr ) {
+                /* Address taken or network changed: forget the lease and ask DHCP */
+                fast_connect_log( "stored address %s %s, running DHCP", stored.ip,
+                                  probe_err == kAlreadyInUseErr ? "is taken" : "got no gateway answer" );
+                micoWlanSuspendStation( );
+                t.lease_reused = false;
+                t.lease_rejected = true;
+                pending.lease_obtained = 0;
+                fast_connect_fill_conf( &conf, &stored, false );
+                err = fast_connect_attempt( &conf, FAST_CONNECT_DIRECTED_TIMEOUT_MS );
+            }
+        }
+
+        t.directed = (err == kNoErr);
+        t.fallback = (err != kNoErr);
+        if ( err != kNoErr ) {
+            t.lease_reused = false;
+        }
+    }
+
+    if ( !t.directed ) {
+        memset( &conf, 0, sizeof(conf) );
+        strncpy( conf.ap_info.ssid, ssid, sizeof(conf.ap_info.ssid) );
+        conf.ap_info.security = SECURITY_TYPE_AUTO;
+        conf.ap_info.channel = 0; /* scan all channels */
+        strncpy( conf.key, passphrase, sizeof(conf.key) );
+        conf.key_len = strlen( passphrase );
+        conf.dhcpMode = DHCP_Client;
+        conf.wifi_retry_interval = 100;
+
+        fast_connect_log( "full connect to %s", ssid );
+        err = fast_connect_attempt( &conf, FAST_CONNECT_FULL_TIMEOUT_MS );
+        require_noerr( err, exit );
+    }
+
+    t.associated_ms = associated_at - connect_start;
+    t.ip_ms = ip_at - connect_start;
+    t.uptime_ms = mico_rtos_get_time( );
+    t.total_ms = t.uptime_ms - connect_start;
+
+    /* A reused address was checked with the gateway's ARP answer already.
+     * After DHCP that phase is only timed on request, outside total_ms. */
+    if ( !arp_at && gateway_probe && pending.gateway[0] ) {
+        fast_connect_arp_probe( NULL, pending.gateway, &arp_at );
+    }
+    t.first_packet_ms = arp_at ? arp_at - connect_start : 0;
+
+    /* Write only when something changed, flash would wear out on every wake otherwise.
+     * The lease time changes with every DHCP run, it is only stored when the
+     * stored lease can no longer be reused. Without a PMK from the driver there
+     * is nothing worth storing. */
+    pending.pass_hash = pass_hash;
+    lease_renewed = pending.lease_obtained
+                    && (t.lease_rejected || !have_record || !fast_connect_lease_fresh( &stored ));
+    if ( pending.key_len > 0
+         && (!have_record || lease_renewed
+             || memcmp( pending.ssid, stored.ssid, offsetof(fast_connect_record_t, lease_obtained)
+                        - offsetof(fast_connect_record_t, ssid) ) != 0) ) {
+        if ( fast_connect_save( &pending ) == kNoErr ) {
+            fast_connect_log( "association saved" );
+        }
+    }
+
+exit:
+    if ( timing ) {
+        *timing = t;
+    }
+    return err;
+}
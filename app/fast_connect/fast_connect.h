@@ -0,0 +1,139 @@
+/* MiCO Team
+ * Copyright (c) 2017 MXCHIP Information Tech. Co.,Ltd
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/******************************************************
+ *                    Constants
+ ******************************************************/
+
+/* Flash partition holding the record, not used by anything else here
+ * because mico_system_init() is not called by the apps */
+#ifndef FAST_CONNECT_PARTITION
+#define FAST_CONNECT_PARTITION          MICO_PARTITION_PARAMETER_2
+#endif
+
+#define FAST_CONNECT_MAGIC              (0x46434F32) /* "FCO2" */
+
+/* Give up on the stored BSSID/channel after this long and scan */
+#define FAST_CONNECT_DIRECTED_TIMEOUT_MS (3000)
+#define FAST_CONNECT_FULL_TIMEOUT_MS    (20000)
+
+/* MiCO does not report the DHCP lease time, set it to the server's lease.
+ * A stored address is reused only during the first half of it (T1), when
+ * the server still holds the address for this client. */
+#ifndef FAST_CONNECT_LEASE_S
+#define FAST_CONNECT_LEASE_S            (3600)
+#endif
+
+/* ARP check of a reused address: requests for the address itself and for
+ * the gateway, sent again every RETRY until the gateway answers or TIMEOUT */
+#define FAST_CONNECT_ARP_TIMEOUT_MS     (500)
+#define FAST_CONNECT_ARP_RETRY_MS       (100)
+#define FAST_CONNECT_ARP_POLL_MS        (5)
+
+/******************************************************
+ *                    Structures
+ ******************************************************/
+
+/*
+ * Last good association, kept in flash. "key" holds the PMK reported by
+ * the driver (64 hex digits), so a fast connect skips the PBKDF2 run over
+ * the passphrase. "pass_hash" tells whether the passphrase changed since.
+ */
+typedef struct fast_connect_record_s
+{
+    uint32_t magic;
+    char ssid[33];
+    uint8_t bssid[6];
+    uint8_t channel;
+    uint8_t security;   /* wlan_sec_type_t */
+    uint8_t key_len;
+    char key[65];
+    uint32_t pass_hash;
+    char ip[16];
+    char gateway[16];
+    char netmask[16];
+    char dns[16];
+    uint32_t lease_obtained; /* RTC seconds, 0 if unknown */
+    uint32_t checksum;
+} fast_connect_record_t;
+
+/* Milliseconds from the start of fast_connect() to each event */
+typedef struct fast_connect_timing_s
+{
+    bool directed;            /* connected with the stored record */
+    bool fallback;            /* directed attempt failed, then scanned */
+    bool lease_reused;        /* stored address used without DHCP */
+    bool lease_rejected;      /* stored address taken or gateway silent, DHCP ran */
+    uint32_t associated_ms;   /* NOTIFY_STATION_UP */
+    uint32_t ip_ms;           /* address configured */
+    uint32_t first_packet_ms; /* gateway answered ARP, 0 if not probed or no answer */
+    uint32_t total_ms;        /* connected and addressed, a reused address also ARP checked */
+    uint32_t uptime_ms;       /* time since boot when done */
+} fast_connect_timing_t;
+
+/******************************************************
+ *               Function Declarations
+ ******************************************************/
+
+/**
+  * @brief  Register the Wi-Fi notifications used by fast_connect().
+  * @retval kNoErr is returned on success, otherwise, kXXXErr is returned.
+  */
+OSStatus fast_connect_init( void );
+
+/**
+  * @brief  Connect to a network, first with the stored BSSID, channel,
+  *         security and PMK, then with a full scan if that fails. The
+  *         record is updated when the association changed.
+  * @param  ssid: network name.
+  * @param  passphrase: WPA passphrase.
+  * @param  timing: receives the connect timing, may be NULL.
+  * @retval kNoErr is returned on success, otherwise, kXXXErr is returned.
+  */
+OSStatus fast_connect( const char *ssid, const char *passphrase, fast_connect_timing_t *timing );
+
+/**
+  * @brief  Reuse the stored address while its lease is fresh instead of
+  *         running DHCP. On by default.
+  * @param  enable: true to reuse the lease.
+  * @retval None
+  */
+void fast_connect_set_lease_reuse( bool enable );
+
+/**
+  * @brief  Time an ARP round trip to the gateway after a DHCP connect too.
+  *         Measurement only: it runs after the connect is complete and is
+  *         not part of total_ms. Off by default.
+  * @param  enable: true to probe the gateway.
+  * @retval None
+  */
+void fast_connect_set_gateway_probe( bool enable );
+
+/**
+  * @brief  Erase the stored record, the next connect scans.
+  * @retval kNoErr is returned on success, otherwise, kXXXErr is returned.
+  */
+OSStatus fast_connect_forget( void );
+
+#ifdef __cplusplus
+} /*extern "C" */
+#endif
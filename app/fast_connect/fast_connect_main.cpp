@@ -0,0 +1,85 @@
+/* MiCO Team
+ * Copyright (c) 2017 MXCHIP Information Tech. Co.,Ltd
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "mbed.h"
+#include "mico.h"
+
+#include "fast_connect.h"
+
+#define  fast_connect_test_log(M, ...) custom_log("FastConnect", M, ##__VA_ARGS__)
+
+/* Wake cycles simulated after boot, the station is suspended in between.
+ * The second half of the cycles reuses the DHCP lease. */
+#define FAST_CONNECT_CYCLES     (6)
+#define FAST_CONNECT_SLEEP_MS   (5000)
+
+static void print_timing( int cycle, const fast_connect_timing_t *t )
+{
+    printf( "cycle %d: %-8s %-8s associated %5lu ms, IP %5lu ms, first packet %5lu ms, total %5lu ms, uptime %lu ms\r\n",
+            cycle, t->directed ? "directed" : (t->fallback ? "fallback" : "full"),
+            t->lease_reused ? "lease" : (t->lease_rejected ? "rejected" : "DHCP"),
+            (unsigned long) t->associated_ms, (unsigned long) t->ip_ms, (unsigned long) t->first_packet_ms,
+            (unsigned long) t->total_ms, (unsigned long) t->uptime_ms );
+}
+
+int app_fast_connect( void )
+{
+    OSStatus err = kNoErr;
+    fast_connect_timing_t timing;
+    uint32_t directed_ms = 0, full_ms = 0, lease_ms = 0;
+    int directed = 0, full = 0, lease = 0;
+
+    MicoInit( );
+
+    err = fast_connect_init( );
+    require_noerr( err, exit );
+    fast_connect_set_gateway_probe( true );
+
+    for ( int cycle = 1; cycle <= FAST_CONNECT_CYCLES; cycle++ ) {
+        fast_connect_set_lease_reuse( cycle > FAST_CONNECT_CYCLES / 2 );
+        err = fast_connect( MBED_CONF_APP_WIFI_SSID, MBED_CONF_APP_WIFI_PASSWORD, &timing );
+        if ( err != kNoErr ) {
+            fast_connect_test_log( "cycle %d: connect failed %d", cycle, err );
+        } else {
+            print_timing( cycle, &timing );
+            if ( cycle == 1 ) {
+                printf( "boot to connected: %lu ms\r\n", (unsigned long) timing.uptime_ms );
+            }
+            if ( timing.lease_reused ) {
+                lease_ms += timing.total_ms;
+                lease++;
+            } else if ( timing.directed ) {
+                directed_ms += timing.total_ms;
+                directed++;
+            } else {
+                full_ms += timing.total_ms;
+                full++;
+            }
+        }
+
+        /* Stand-in for deep sleep: drop the link and wake up later */
+        micoWlanSuspendStation( );
+        mico_thread_msleep( FAST_CONNECT_SLEEP_MS );
+    }
+
+    printf( "\r\naverage connect: directed + lease %lu ms (%d), directed + DHCP %lu ms (%d), full %lu ms (%d)\r\n",
+            (unsigned long) (lease ? lease_ms / lease : 0), lease,
+            (unsigned long) (directed ? directed_ms / directed : 0), directed,
+            (unsigned long) (full ? full_ms / full : 0), full );
+
+exit:
+    return err;
+}
@@ -18,6 +18,7 @@
 
 #include "iperf_debug.h"
 #include "iperf_task.h"
+#include "iperf_profile.h"
 
 /******************************************************
  *                      Macros
@@ -183,12 +184,13 @@ static void _cli_iperf_client_Command( int argc, char **argv )
 static void _cli_iperf_help_Command( int argc, char **argv )
 {
     printf( "Usage: iperf [-s|-c] [options]\r\n" );
+    printf( "       iperf -P <ip> <profile> [port]\r\n" );
     printf( "       iperf [-h]\r\n\n" );
     printf( "Client/Server:\r\n" );
     printf( "  -u,        use UDP rather than TCP\r\n" );
     printf( "  -p,        #server port to listen on/connect to (default 5001)\r\n" );
     printf( "  -n,        #[kmKM]    number of bytes to transmit \r\n" );
-    printf( "  -b,        #[kmKM]    for UDP, bandwidth to send at in bits/sec\r\n" );
+    printf( "  -b,        #[kmKM]    bandwidth to send at in bits/sec, TCP writes are paced evenly\r\n" );
     printf( "  -i,        10 seconds between periodic bandwidth reports \r\n\n" );
     printf( "Server specific:\r\n" );
     printf( "  -s,        run in server mode\r\n" );
@@ -197,9 +199,14 @@ static void _cli_iperf_help_Command( int argc, char **argv )
     printf( "Client specific:\r\n" );
     printf( "  -c,        <ip>run in client mode, connecting to <ip>\r\n" );
     printf( "  -w,        #[kmKM]    TCP window size\r\n" );
+    printf( "  -F,        for TCP, send from a read-only flash payload instead of a RAM buffer\r\n" );
     printf( "  -l,        #[kmKM]    UDP datagram size\r\n" );
     printf( "  -t,        #time in seconds to transmit for (default 10 secs)\r\n" );
-    printf( "  -S,        #the type-of-service of outgoing packets\r\n\n" );
+    printf( "  -S,        #the type-of-service of outgoing packets\r\n" );
+    printf( "  --at,      <epoch_ms>    connect now, start sending at this UTC time\r\n" );
+    printf( "  --on-trigger,            connect now, start sending on a trigger packet (UDP port 5002)\r\n" );
+    printf( "  --trigger-timeout, #secs to wait for the trigger, 0 for ever (default 600 secs)\r\n" );
+    printf( "  --ntp,     <ip>    set the UTC clock from this SNTP server before waiting\r\n\n" );
     printf( "Miscellaneous:\r\n" );
     printf( "  -h,        print this message and quit\r\n\n" );
     printf( "[kmKM] Indicates options that support a k/K or m/M suffix for kilo- or mega-\r\n\n" );
@@ -210,6 +217,13 @@ static void _cli_iperf_help_Command( int argc, char **argv )
     printf( "VO: -S 224\r\n\n" );
     printf( "Tradeoff Testing Mode:\r\n" );
     printf( "Command: iperf -s -u -n <bits/bytes> -r \r\n\n" );
+    printf( "Traffic Profile:\r\n" );
+    printf( "Command: iperf -P <ip> idle:5,udp:10:2m,tcp:1M*3 \r\n" );
+    printf( "  idle:<secs>, udp:<secs>:<bits/sec>, tcp:<bytes>, \"*N\" repeats the list\r\n" );
+    iperf_profile_list( );
+    printf( "\r\n" );
+    printf( "Synchronized Start:\r\n" );
+    printf( "Trigger packet: \"IPRF\" + 8 bytes big endian sender UTC ms (0 if unknown)\r\n\n" );
     printf( "Example:\r\n" );
     printf( "Iperf TCP Server: iperf -s\r\n" );
     printf( "Iperf UDP Server: iperf -s -u\r\n" );
@@ -244,6 +258,11 @@ void iperf_Command( char *pcWriteBuffer, int xWriteBufferLen, int argc, char **a
         _cli_iperf_client_Command( argc - 2, &argv[2] );
     }
     else
+    if ( strcmp( argv[1], "-P" ) == 0 )
+    {
+        iperf_profile_start( argc - 2, &argv[2] );
+    }
+    else
     if ( strcmp( argv[1], "-h" ) == 0 )
     {
         _cli_iperf_help_Command( argc - 2, &argv[2] );
@@ -0,0 +1,103 @@
+/* MiCO Team
+ * Copyright (c) 2017 MXCHIP Information Tech. Co.,Ltd
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "mico.h"
+
+#include "iperf_latency.h"
+
+/******************************************************
+ *               Function Definitions
+ ******************************************************/
+
+void iperf_latency_init( iperf_latency_t *lat )
+{
+    memset( lat, 0, sizeof(iperf_latency_t) );
+    mico_time_get_time( &lat->t0_ms );
+
+    /* DWT->CYCCNT is free running, enabling it again is harmless */
+    CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+    DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+}
+
+void iperf_latency_note_stall( iperf_latency_t *lat, uint32_t cycles )
+{
+    int i, min = 0;
+    uint32_t now;
+
+    for ( i = 1; i < IPERF_LATENCY_STALLS; i++ ) {
+        if ( lat->stall[i].cycles < lat->stall[min].cycles ) {
+            min = i;
+        }
+    }
+
+    mico_time_get_time( &now );
+    lat->stall[min].cycles = cycles;
+    lat->stall[min].time_ms = now - lat->t0_ms;
+
+    lat->stall_floor = cycles;
+    for ( i = 0; i < IPERF_LATENCY_STALLS; i++ ) {
+        if ( lat->stall[i].cycles < lat->stall_floor ) {
+            lat->stall_floor = lat->stall[i].cycles;
+        }
+    }
+}
+
+void iperf_latency_report( const char *title, const iperf_latency_t *lat )
+{
+    int i, j;
+    uint32_t cyc_per_us = SystemCoreClock / 1000000;
+    iperf_latency_stall_t stall[IPERF_LATENCY_STALLS];
+    iperf_latency_stall_t swap;
+
+    if ( cyc_per_us == 0 ) {
+        cyc_per_us = 1;
+    }
+
+    if ( lat->calls == 0 ) {
+        printf( "%s() latency: no calls\r\n", title );
+        return;
+    }
+
+    printf( "%s() latency: %u calls, mean %u us\r\n", title, (unsigned) lat->calls,
+            (unsigned) (lat->total_cycles / lat->calls / cyc_per_us) );
+
+    for ( i = 0; i < IPERF_LATENCY_BUCKETS; i++ ) {
+        if ( lat->bucket[i] == 0 ) {
+            continue;
+        }
+        printf( "  < %8u us : %u\r\n", (unsigned) (((uint64_t) 2 << i) / cyc_per_us),
+                (unsigned) lat->bucket[i] );
+    }
+
+    /* longest first */
+    memcpy( stall, lat->stall, sizeof(stall) );
+    for ( i = 0; i < IPERF_LATENCY_STALLS; i++ ) {
+        for ( j = i + 1; j < IPERF_LATENCY_STALLS; j++ ) {
+            if ( stall[j].cycles > stall[i].cycles ) {
+                swap = stall[i];
+                stall[i] = stall[j];
+                stall[j] = swap;
+            }
+        }
+    }
+
+    printf( "  longest stalls:\r\n" );
+    for ( i = 0; i < IPERF_LATENCY_STALLS && stall[i].cycles != 0; i++ ) {
+        printf( "    %u us at %u.%03u sec\r\n", (unsigned) (stall[i].cycles / cyc_per_us),
+                (unsigned) (stall[i].time_ms / 1000), (unsigned) (stall[i].time_ms % 1000) );
+    }
+    printf( "\r\n" );
+}
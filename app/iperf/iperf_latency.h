@@ -0,0 +1,103 @@
+/* MiCO Team
+ * Copyright (c) 2017 MXCHIP Information Tech. Co.,Ltd
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include "cmsis.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/******************************************************
+ *                    Constants
+ ******************************************************/
+
+/* bucket n holds calls that took [2^n, 2^(n+1)) cycles */
+#define IPERF_LATENCY_BUCKETS   (32)
+
+/* number of longest calls kept with their timestamp */
+#define IPERF_LATENCY_STALLS    (4)
+
+/******************************************************
+ *                    Structures
+ ******************************************************/
+
+typedef struct iperf_latency_stall_s
+{
+    uint32_t cycles;
+    uint32_t time_ms; /* ms since iperf_latency_init() when the call returned */
+} iperf_latency_stall_t;
+
+typedef struct iperf_latency_s
+{
+    uint32_t bucket[IPERF_LATENCY_BUCKETS];
+    uint32_t calls;
+    uint64_t total_cycles;
+    uint32_t stall_floor; /* shortest entry in stall[], cheap reject test */
+    uint32_t t0_ms;
+    iperf_latency_stall_t stall[IPERF_LATENCY_STALLS];
+} iperf_latency_t;
+
+/******************************************************
+ *               Function Declarations
+ ******************************************************/
+
+/**
+  * @brief  Enable the DWT cycle counter and clear a latency histogram.
+  * @param  lat: histogram to clear.
+  * @retval none.
+  */
+void iperf_latency_init( iperf_latency_t *lat );
+
+/**
+  * @brief  Keep a call in the longest-stall table, called only when it beats stall_floor.
+  * @param  lat: histogram.
+  * @param  cycles: duration of the call.
+  * @retval none.
+  */
+void iperf_latency_note_stall( iperf_latency_t *lat, uint32_t cycles );
+
+/**
+  * @brief  Print the histogram, the mean call time and the longest stalls.
+  * @param  title: name of the measured call, e.g. "send".
+  * @param  lat: histogram to print.
+  * @retval none.
+  */
+void iperf_latency_report( const char *title, const iperf_latency_t *lat );
+
+/* Take a cycle stamp before the socket call */
+static inline uint32_t iperf_latency_start( void )
+{
+    return DWT->CYCCNT;
+}
+
+/* Account the call started at "start", a handful of cycles in the common case */
+static inline void iperf_latency_record( iperf_latency_t *lat, uint32_t start )
+{
+    uint32_t cycles = DWT->CYCCNT - start;
+
+    lat->bucket[cycles ? 31 - __CLZ( cycles ) : 0]++;
+    lat->calls++;
+    lat->total_cycles += cycles;
+    if ( cycles > lat->stall_floor ) {
+        iperf_latency_note_stall( lat, cycles );
+    }
+}
+
+#ifdef __cplusplus
+} /*extern "C" */
+#endif
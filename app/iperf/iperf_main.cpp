@@ -18,6 +18,7 @@
 #include "mico.h"
 
 #include "iperf_cli.h"
+#include "iperf_netstat.h"
 
 #define  iperf_test_log(M, ...) custom_log("Iperf", M, ##__VA_ARGS__)
 
@@ -74,7 +75,8 @@ int app_iperf( void )
 
     /* Register iperf command to test   */
     iperf_cli_register();
-    iperf_test_log( "iPerf tester started, input \"iperf -h\" for help." );
+    iperf_netstat_cli_register();
+    iperf_test_log( "iPerf tester started, input \"iperf -h\" for help, \"netstat -i 1\" to watch the stack." );
 
 exit:
     return err;
@@ -0,0 +1,201 @@
+/* MiCO Team
+ * Copyright (c) 2017 MXCHIP Information Tech. Co.,Ltd
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "mico.h"
+#include "lwip/stats.h"
+#include "lwip/memp.h"
+
+#include "iperf_task.h"
+#include "iperf_netstat.h"
+
+/******************************************************
+ *               Function Declarations
+ ******************************************************/
+
+void netstat_Command( char *pcWriteBuffer, int xWriteBufferLen, int argc, char **argv );
+
+struct cli_command netstat_message_cmd[] = {
+    { NETSTAT_NAME, "network stack statistics, -i <secs> for changes, -x to stop", netstat_Command },
+};
+
+/******************************************************
+ *               Variables Definitions
+ ******************************************************/
+
+static volatile bool netstat_running = false;
+static volatile uint32_t netstat_interval_s;
+/* Bumped by "-x": a reporter still asleep from an earlier "-i" ends when it
+ * wakes, even if a new one was started meanwhile */
+static volatile uint32_t netstat_generation;
+/* The snapshots are shared by the reporter and one-shot "netstat" */
+static mico_mutex_t netstat_mutex = NULL;
+
+#if LWIP_STATS
+/* Last snapshot, interval mode prints the difference to it */
+static struct stats_ netstat_prev;
+
+#if MEMP_STATS
+static const char * const netstat_memp_names[] = {
+#define LWIP_MEMPOOL(name,num,size,desc) desc,
+#include "lwip/memp_std.h"
+};
+#endif
+#endif
+
+/******************************************************
+ *               Function Definitions
+ ******************************************************/
+
+#if LWIP_STATS
+static void netstat_print_proto( const char *name, const struct stats_proto *now, const struct stats_proto *prev )
+{
+#define NETSTAT_DELTA(f) ((unsigned) (now->f - (prev ? prev->f : 0)))
+    printf( "%-7s xmit %7u recv %7u fw %5u drop %5u chkerr %4u lenerr %4u memerr %4u rterr %4u proterr %4u opterr %4u err %4u\r\n",
+            name, NETSTAT_DELTA(xmit), NETSTAT_DELTA(recv), NETSTAT_DELTA(fw), NETSTAT_DELTA(drop),
+            NETSTAT_DELTA(chkerr), NETSTAT_DELTA(lenerr), NETSTAT_DELTA(memerr), NETSTAT_DELTA(rterr),
+            NETSTAT_DELTA(proterr), NETSTAT_DELTA(opterr), NETSTAT_DELTA(err) );
+#undef NETSTAT_DELTA
+}
+
+static void netstat_print_mem( const char *name, const struct stats_mem *now, const struct stats_mem *prev )
+{
+    /* avail/used/max are levels, err is a counter */
+    printf( "%-16s avail %6u used %6u max %6u err %4u%s\r\n", name,
+            (unsigned) now->avail, (unsigned) now->used, (unsigned) now->max,
+            (unsigned) (now->err - (prev ? prev->err : 0)),
+            now->used >= now->avail && now->avail ? "  <- exhausted" : "" );
+}
+#endif
+
+/* "keep" makes this the reporter's new baseline, one-shot prints leave it alone */
+static void netstat_print( bool delta, bool keep )
+{
+    micoMemInfo_t *heap = MicoGetMemoryInfo( );
+
+    mico_rtos_lock_mutex( &netstat_mutex );
+#if LWIP_STATS
+    /* Static like netstat_prev, the stats are too large for the thread stack */
+    static struct stats_ now;
+    int i;
+
+    /* One copy, so the lines of a report belong to the same moment */
+    memcpy( &now, &lwip_stats, sizeof(now) );
+
+#if MEM_STATS
+    netstat_print_mem( "heap (lwIP)", &now.mem, delta ? &netstat_prev.mem : NULL );
+#endif
+#if MEMP_STATS
+    for ( i = 0; i < MEMP_MAX; i++ ) {
+        netstat_print_mem( netstat_memp_names[i], &now.memp[i], delta ? &netstat_prev.memp[i] : NULL );
+    }
+    printf( "sockets (netconns in use): %u\r\n", (unsigned) now.memp[MEMP_NETCONN].used );
+#endif
+#if LINK_STATS
+    netstat_print_proto( "link", &now.link, delta ? &netstat_prev.link : NULL );
+#endif
+#if ETHARP_STATS
+    netstat_print_proto( "etharp", &now.etharp, delta ? &netstat_prev.etharp : NULL );
+#endif
+#if IP_STATS
+    netstat_print_proto( "ip", &now.ip, delta ? &netstat_prev.ip : NULL );
+#endif
+#if IPFRAG_STATS
+    netstat_print_proto( "ip_frag", &now.ip_frag, delta ? &netstat_prev.ip_frag : NULL );
+#endif
+#if ICMP_STATS
+    netstat_print_proto( "icmp", &now.icmp, delta ? &netstat_prev.icmp : NULL );
+#endif
+#if UDP_STATS
+    netstat_print_proto( "udp", &now.udp, delta ? &netstat_prev.udp : NULL );
+#endif
+#if TCP_STATS
+    netstat_print_proto( "tcp", &now.tcp, delta ? &netstat_prev.tcp : NULL );
+#endif
+
+    if ( keep ) {
+        memcpy( &netstat_prev, &now, sizeof(now) );
+    }
+#else
+    printf( "lwIP was built without LWIP_STATS, only the heap is shown\r\n" );
+#endif
+
+    /* The Wi-Fi driver does not report its TX/RX queue depths */
+    printf( "heap (MiCO): total %d free %d allocated %d chunks %d\r\n",
+            heap->total_memory, heap->free_memory, heap->allocted_memory, heap->num_of_chunks );
+    mico_rtos_unlock_mutex( &netstat_mutex );
+}
+
+static void netstat_thread( mico_thread_arg_t arg )
+{
+    uint32_t generation = (uint32_t) arg;
+    uint32_t tick = 0;
+
+    /* Baseline, the first report shows the changes of the first interval */
+    netstat_print( false, true );
+
+    while ( netstat_generation == generation ) {
+        mico_thread_msleep( netstat_interval_s * 1000 );
+        if ( netstat_generation != generation ) {
+            break;
+        }
+        tick += netstat_interval_s;
+        printf( "\r\n[netstat +%lu s, changes over the last %lu s]\r\n",
+                (unsigned long) tick, (unsigned long) netstat_interval_s );
+        netstat_print( true, true );
+    }
+
+    mico_rtos_delete_thread( NULL );
+}
+
+void netstat_Command( char *pcWriteBuffer, int xWriteBufferLen, int argc, char **argv )
+{
+    if ( argc >= 2 && strcmp( argv[1], "-x" ) == 0 ) {
+        netstat_generation++;
+        netstat_running = false;
+        return;
+    }
+
+    if ( argc >= 3 && strcmp( argv[1], "-i" ) == 0 ) {
+        if ( netstat_running ) {
+            printf( "netstat is already running, stop it with \"netstat -x\"\r\n" );
+            return;
+        }
+        netstat_interval_s = atoi( argv[2] );
+        if ( netstat_interval_s == 0 ) {
+            netstat_interval_s = 1;
+        }
+        netstat_running = true;
+        if ( mico_rtos_create_thread( NULL, IPERF_PRIO, NETSTAT_NAME, netstat_thread, NETSTAT_STACKSIZE,
+                                      (mico_thread_arg_t) netstat_generation ) != kNoErr ) {
+            netstat_running = false;
+            printf( "netstat: no memory for the thread\r\n" );
+        }
+        return;
+    }
+
+    netstat_print( false, false );
+}
+
+OSStatus iperf_netstat_cli_register( void )
+{
+    if ( !netstat_mutex ) {
+        mico_rtos_init_mutex( &netstat_mutex );
+    }
+    if( 0 == cli_register_commands( netstat_message_cmd, 1 ) )
+        return kNoErr;
+    else
+        return kGeneralErr;
+}
@@ -0,0 +1,354 @@
+/* MiCO Team
+ * Copyright (c) 2017 MXCHIP Information Tech. Co.,Ltd
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "mico.h"
+
+#include "iperf_debug.h"
+#include "iperf_task.h"
+#include "iperf_profile.h"
+
+#include "us_ticker_api.h"
+
+/******************************************************
+ *                    Structures
+ ******************************************************/
+
+typedef struct iperf_profile_builtin_s
+{
+    const char *name;
+    const char *text;
+} iperf_profile_builtin_t;
+
+/******************************************************
+ *               Variables Definitions
+ ******************************************************/
+
+/* Built-in profiles live in flash, "iperf -P <ip> <name>" runs them */
+static const iperf_profile_builtin_t iperf_profile_builtin[] = {
+    { "duty",      "idle:5,udp:10:2m,tcp:1M*3" },
+    { "telemetry", "udp:30:64k,tcp:16K*10" },
+    { "burst",     "tcp:256K,idle:1*10" },
+};
+
+static const char *iperf_phase_name[] = { "IDLE", "UDP", "TCP" };
+
+/******************************************************
+ *               Function Definitions
+ ******************************************************/
+
+static int iperf_profile_number( const char **p, uint32_t *value )
+{
+    const char *s = *p;
+    uint32_t v = 0;
+
+    if ( *s < '0' || *s > '9' ) {
+        return -1;
+    }
+    while ( *s >= '0' && *s <= '9' ) {
+        v = v * 10 + (*s++ - '0');
+    }
+
+    switch ( *s )
+    {
+        case 'k':
+            v *= 1000;
+            s++;
+            break;
+        case 'm':
+            v *= 1000 * 1000;
+            s++;
+            break;
+        case 'K':
+            v *= 1024;
+            s++;
+            break;
+        case 'M':
+            v *= 1024 * 1024;
+            s++;
+            break;
+        default:
+            break;
+    }
+
+    *value = v;
+    *p = s;
+    return 0;
+}
+
+static int iperf_profile_keyword( const char **p, const char *word )
+{
+    size_t len = strlen( word );
+
+    if ( strncmp( *p, word, len ) != 0 ) {
+        return 0;
+    }
+    *p += len;
+    return 1;
+}
+
+OSStatus iperf_profile_parse( const char *text, iperf_profile_t *profile )
+{
+    OSStatus err = kNoErr;
+    const char *p = text;
+    iperf_phase_t *phase;
+    uint32_t value;
+    int i;
+
+    for ( i = 0; i < sizeof(iperf_profile_builtin) / sizeof(iperf_profile_builtin[0]); i++ ) {
+        if ( strcmp( text, iperf_profile_builtin[i].name ) == 0 ) {
+            p = iperf_profile_builtin[i].text;
+            break;
+        }
+    }
+
+    profile->phase_num = 0;
+    profile->repeat = 1;
+
+    while ( *p != '\0' ) {
+        require_action( profile->phase_num < IPERF_PROFILE_MAX_PHASES, exit, err = kNoResourcesErr );
+        phase = &profile->phase[profile->phase_num];
+        memset( phase, 0, sizeof(iperf_phase_t) );
+
+        if ( iperf_profile_keyword( &p, "idle:" ) ) {
+            phase->type = IPERF_PHASE_IDLE;
+            require_action( iperf_profile_number( &p, &value ) == 0, exit, err = kParamErr );
+            phase->duration_ms = value * 1000;
+        } else if ( iperf_profile_keyword( &p, "udp:" ) ) {
+            phase->type = IPERF_PHASE_UDP;
+            require_action( iperf_profile_number( &p, &value ) == 0 && *p == ':', exit, err = kParamErr );
+            phase->duration_ms = value * 1000;
+            p++;
+            require_action( iperf_profile_number( &p, &phase->rate ) == 0 && phase->rate > 0, exit,
+                            err = kParamErr );
+        } else if ( iperf_profile_keyword( &p, "tcp:" ) ) {
+            phase->type = IPERF_PHASE_TCP;
+            require_action( iperf_profile_number( &p, &phase->bytes ) == 0, exit, err = kParamErr );
+        } else {
+            err = kParamErr;
+            goto exit;
+        }
+        profile->phase_num++;
+
+        if ( *p == ',' ) {
+            p++;
+        } else if ( *p == '*' ) {
+            p++;
+            require_action( iperf_profile_number( &p, &value ) == 0 && value > 0 && *p == '\0', exit,
+                            err = kParamErr );
+            profile->repeat = value;
+        } else {
+            require_action( *p == '\0', exit, err = kParamErr );
+        }
+    }
+
+    require_action( profile->phase_num > 0, exit, err = kParamErr );
+
+exit:
+    return err;
+}
+
+static void iperf_profile_run_udp( int sockfd, char *buffer, const iperf_phase_t *phase, count_t *pkt_count )
+{
+    uint32_t *udp_h = (uint32_t *) buffer; /* id, tv_sec, tv_usec, same layout as UDP_datagram */
+    uint32_t interval_us = (uint32_t) ((uint64_t) IPERF_PROFILE_UDP_SIZE * 8 * 1000000 / phase->rate);
+    uint32_t t_start, now, due;
+    int32_t id = 0;
+    int nbytes;
+
+    iperf_get_current_time( 0, &t_start );
+    due = us_ticker_read( );
+
+    do {
+        iperf_get_current_time( 0, &now );
+        udp_h[0] = htonl( id++ );
+        udp_h[1] = htonl( now / 1000 );
+        udp_h[2] = htonl( (now % 1000) * 1000 );
+
+        nbytes = send( sockfd, buffer, IPERF_PROFILE_UDP_SIZE, 0 );
+        *pkt_count = iperf_calculate_result( nbytes, *pkt_count, 0 );
+
+        due += interval_us;
+        iperf_pace_wait( due );
+    } while ( now - t_start < phase->duration_ms );
+
+    // a negative id ends the stream, the server prints its report
+    udp_h[0] = htonl( -id );
+    send( sockfd, buffer, IPERF_PROFILE_UDP_SIZE, 0 );
+}
+
+static OSStatus iperf_profile_run_tcp( int sockfd, char *buffer, const iperf_phase_t *phase, count_t *pkt_count )
+{
+    uint32_t remain = phase->bytes;
+    int nbytes;
+
+    while ( remain > 0 ) {
+        nbytes = send( sockfd, buffer, remain < IPERF_PROFILE_BUFFER_SIZE ? remain : IPERF_PROFILE_BUFFER_SIZE, 0 );
+        if ( nbytes <= 0 ) {
+            return kConnectionErr;
+        }
+        *pkt_count = iperf_calculate_result( nbytes, *pkt_count, 0 );
+        remain -= nbytes;
+    }
+
+    return kNoErr;
+}
+
+static void iperf_profile_thread( mico_thread_arg_t arg )
+{
+    OSStatus err = kNoErr;
+    iperf_profile_t *profile = (iperf_profile_t *) arg;
+    const iperf_phase_t *phase;
+    char *buffer = NULL;
+    int udp_fd = -1, tcp_fd = -1;
+    int has_udp = 0, has_tcp = 0;
+    struct sockaddr_in servaddr;
+    count_t phase_count;
+    count_t total_count;
+    uint32_t t_start, t_phase, t_end;
+    char title[40];
+    int r, i;
+
+    buffer = (char*) malloc( IPERF_PROFILE_BUFFER_SIZE );
+    require_action( buffer, exit, err = kNoMemoryErr );
+    memset( buffer, 0, IPERF_PROFILE_BUFFER_SIZE );
+
+    for ( i = 0; i < profile->phase_num; i++ ) {
+        has_udp |= (profile->phase[i].type == IPERF_PHASE_UDP);
+        has_tcp |= (profile->phase[i].type == IPERF_PHASE_TCP);
+    }
+
+    memset( &servaddr, 0, sizeof(servaddr) );
+    servaddr.sin_family = AF_INET;
+    servaddr.sin_addr.s_addr = profile->server_addr;
+    servaddr.sin_port = htons( profile->port );
+
+    /* Sockets are set up once, so a phase transition costs nothing but the phase itself */
+    if ( has_udp ) {
+        udp_fd = socket( AF_INET, SOCK_DGRAM, 0 );
+        require_action( udp_fd >= 0, exit, err = kNoResourcesErr );
+        require_action( connect( udp_fd, (struct sockaddr *) &servaddr, sizeof(servaddr) ) >= 0, exit,
+                        err = kConnectionErr );
+    }
+    if ( has_tcp ) {
+        tcp_fd = socket( AF_INET, SOCK_STREAM, 0 );
+        require_action( tcp_fd >= 0, exit, err = kNoResourcesErr );
+        require_action( connect( tcp_fd, (struct sockaddr *) &servaddr, sizeof(servaddr) ) >= 0, exit,
+                        err = kConnectionErr );
+    }
+
+    total_count = iperf_reset_count( total_count );
+    iperf_get_current_time( 0, &t_start );
+
+    for ( r = 0; r < profile->repeat; r++ ) {
+        for ( i = 0; i < profile->phase_num; i++ ) {
+            phase = &profile->phase[i];
+            phase_count = iperf_reset_count( phase_count );
+            iperf_get_current_time( 0, &t_phase );
+
+            switch ( phase->type )
+            {
+                case IPERF_PHASE_IDLE:
+                    mico_thread_msleep( phase->duration_ms );
+                    break;
+                case IPERF_PHASE_UDP:
+                    iperf_profile_run_udp( udp_fd, buffer, phase, &phase_count );
+                    break;
+                case IPERF_PHASE_TCP:
+                    err = iperf_profile_run_tcp( tcp_fd, buffer, phase, &phase_count );
+                    break;
+            }
+
+            iperf_get_current_time( 0, &t_end );
+            t_end -= t_phase;
+            snprintf( title, sizeof(title), "[Run %d Phase %d %s]", r + 1, i + 1, iperf_phase_name[phase->type] );
+            if ( phase->type == IPERF_PHASE_IDLE ) {
+                printf( "%s %u ms\r\n\r\n", title, (unsigned) t_end );
+            } else {
+                printf( "%s %u ms, %u bytes, ", title, (unsigned) t_end, phase_count.Bytes );
+                iperf_display_report( "", t_end / 1000, (t_end / 100) % 10, phase_count );
+            }
+
+            total_count.Bytes += phase_count.Bytes;
+            total_count.times += phase_count.times;
+            require_noerr_string( err, exit, "TCP connection lost" );
+        }
+    }
+
+    iperf_get_current_time( 0, &t_end );
+    t_end -= t_start;
+    printf( "[Total]Profile %u ms, %u bytes, ", (unsigned) t_end, total_count.Bytes );
+    iperf_display_report( "", t_end / 1000, (t_end / 100) % 10, total_count );
+
+exit:
+    if ( err != kNoErr ) {
+        printf( "Iperf profile stopped, err = %d\r\n", err );
+    }
+    if ( udp_fd >= 0 ) {
+        close( udp_fd );
+    }
+    if ( tcp_fd >= 0 ) {
+        close( tcp_fd );
+    }
+    if ( buffer ) {
+        free( buffer );
+    }
+    free( profile );
+    mico_rtos_delete_thread( NULL );
+}
+
+void iperf_profile_list( void )
+{
+    int i;
+
+    printf( "Built-in profiles:\r\n" );
+    for ( i = 0; i < sizeof(iperf_profile_builtin) / sizeof(iperf_profile_builtin[0]); i++ ) {
+        printf( "  %-10s %s\r\n", iperf_profile_builtin[i].name, iperf_profile_builtin[i].text );
+    }
+}
+
+OSStatus iperf_profile_start( int argc, char **argv )
+{
+    OSStatus err = kNoErr;
+    iperf_profile_t *profile = NULL;
+
+    if ( argc < 2 ) {
+        printf( "Usage: iperf -P <ip> <profile> [port]\r\n" );
+        iperf_profile_list( );
+        return kParamErr;
+    }
+
+    profile = (iperf_profile_t *) malloc( sizeof(iperf_profile_t) );
+    require_action( profile, exit, err = kNoMemoryErr );
+
+    err = iperf_profile_parse( argv[1], profile );
+    if ( err != kNoErr ) {
+        printf( "Invalid profile \"%s\"\r\n", argv[1] );
+        goto exit;
+    }
+
+    profile->server_addr = inet_addr( argv[0] );
+    profile->port = (argc > 2) ? atoi( argv[2] ) : IPERF_PROFILE_DEFAULT_PORT;
+
+    printf( "Iperf Profile: Start! %d phases, %d runs\r\n", profile->phase_num, profile->repeat );
+    err = mico_rtos_create_thread( NULL, IPERF_PRIO, IPERF_NAME, iperf_profile_thread, IPERF_STACKSIZE,
+                                   (mico_thread_arg_t) profile );
+
+exit:
+    if ( err != kNoErr && profile ) {
+        free( profile );
+    }
+    return err;
+}
@@ -0,0 +1,94 @@
+/* MiCO Team
+ * Copyright (c) 2017 MXCHIP Information Tech. Co.,Ltd
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/******************************************************
+ *                    Constants
+ ******************************************************/
+
+#define IPERF_PROFILE_MAX_PHASES    (8)
+#define IPERF_PROFILE_UDP_SIZE      (1460)
+#define IPERF_PROFILE_BUFFER_SIZE   (2048)
+#define IPERF_PROFILE_DEFAULT_PORT  (5001)
+
+/******************************************************
+ *                   Enumerations
+ ******************************************************/
+
+typedef enum
+{
+    IPERF_PHASE_IDLE = 0, /* "idle:<secs>" */
+    IPERF_PHASE_UDP,      /* "udp:<secs>:<bits/sec>" */
+    IPERF_PHASE_TCP,      /* "tcp:<bytes>" */
+} iperf_phase_type_t;
+
+/******************************************************
+ *                    Structures
+ ******************************************************/
+
+typedef struct iperf_phase_s
+{
+    iperf_phase_type_t type;
+    uint32_t duration_ms;
+    uint32_t rate;  /* bits/sec */
+    uint32_t bytes;
+} iperf_phase_t;
+
+typedef struct iperf_profile_s
+{
+    uint32_t server_addr; /* network byte order */
+    uint16_t port;
+    int repeat;
+    int phase_num;
+    iperf_phase_t phase[IPERF_PROFILE_MAX_PHASES];
+} iperf_profile_t;
+
+/******************************************************
+ *               Function Declarations
+ ******************************************************/
+
+/**
+  * @brief  Parse a profile such as "idle:5,udp:10:2m,tcp:1M*3".
+  *         Phases are separated by ',', a trailing "*N" repeats the whole list.
+  *         Numbers take the [kmKM] suffixes of the iperf command line.
+  * @param  text: profile text, or the name of a built-in profile.
+  * @param  profile: parsed phases, server fields are left untouched.
+  * @retval kNoErr is returned on success, otherwise, kXXXErr is returned.
+  */
+OSStatus iperf_profile_parse( const char *text, iperf_profile_t *profile );
+
+/**
+  * @brief  Handle "iperf -P <ip> <profile> [port]" and start the runner thread.
+  * @param  argc: number of arguments after "-P".
+  * @param  argv: arguments after "-P".
+  * @retval kNoErr is returned on success, otherwise, kXXXErr is returned.
+  */
+OSStatus iperf_profile_start( int argc, char **argv );
+
+/**
+  * @brief  Print the built-in profiles.
+  * @retval none.
+  */
+void iperf_profile_list( void );
+
+#ifdef __cplusplus
+} /*extern "C" */
+#endif
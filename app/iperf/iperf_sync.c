@@ -0,0 +1,178 @@
+/* MiCO Team
+ * Copyright (c) 2017 MXCHIP Information Tech. Co.,Ltd
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "mico.h"
+
+#include "iperf_sync.h"
+
+/******************************************************
+ *                    Constants
+ ******************************************************/
+
+#define NTP_PORT            (123)
+#define NTP_PACKET_SIZE     (48)
+#define NTP_TIMEOUT_MS      (2000)
+#define NTP_UNIX_OFFSET     (2208988800UL) /* seconds from 1900 to 1970 */
+
+/******************************************************
+ *               Function Definitions
+ ******************************************************/
+
+OSStatus iperf_sync_ntp( uint32_t server )
+{
+    int sockfd;
+    struct sockaddr_in addr;
+    uint8_t pkt[NTP_PACKET_SIZE];
+    uint32_t timeout = NTP_TIMEOUT_MS;
+    uint32_t t_send, t_recv, sec, frac;
+    mico_utc_time_ms_t utc_ms;
+    int nbytes;
+
+    if ( (sockfd = socket( AF_INET, SOCK_DGRAM, 0 )) < 0 ) {
+        return kNoResourcesErr;
+    }
+    setsockopt( sockfd, SOL_SOCKET, SO_RCVTIMEO, (char *) &timeout, sizeof(timeout) );
+
+    memset( &addr, 0, sizeof(addr) );
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = server;
+    addr.sin_port = htons( NTP_PORT );
+
+    memset( pkt, 0, sizeof(pkt) );
+    pkt[0] = 0x1B; /* LI = 0, VN = 3, Mode = client */
+
+    mico_time_get_time( &t_send );
+    sendto( sockfd, pkt, sizeof(pkt), 0, (struct sockaddr *) &addr, sizeof(addr) );
+    nbytes = recv( sockfd, pkt, sizeof(pkt), 0 );
+    mico_time_get_time( &t_recv );
+    close( sockfd );
+
+    if ( nbytes < NTP_PACKET_SIZE ) {
+        printf( "SNTP: no answer from server\r\n" );
+        return kTimeoutErr;
+    }
+
+    /* Transmit timestamp, corrected by half the round trip */
+    sec = ((uint32_t) pkt[40] << 24) | ((uint32_t) pkt[41] << 16) | ((uint32_t) pkt[42] << 8) | pkt[43];
+    frac = ((uint32_t) pkt[44] << 24) | ((uint32_t) pkt[45] << 16) | ((uint32_t) pkt[46] << 8) | pkt[47];
+    utc_ms = (mico_utc_time_ms_t) (sec - NTP_UNIX_OFFSET) * 1000
+             + (((uint64_t) frac * 1000) >> 32)
+             + (t_recv - t_send) / 2;
+    mico_time_set_utc_time_ms( &utc_ms );
+
+    printf( "SNTP: clock set, round trip %u ms\r\n", (unsigned) (t_recv - t_send) );
+    return kNoErr;
+}
+
+static void iperf_sync_wait_at( uint64_t at_ms )
+{
+    mico_utc_time_ms_t now;
+
+    mico_time_get_utc_time_ms( &now );
+    if ( at_ms <= now ) {
+        printf( "Scheduled start is %u ms in the past, starting now\r\n", (unsigned) (now - at_ms) );
+        return;
+    }
+
+    printf( "Start in %u ms\r\n", (unsigned) (at_ms - now) );
+    if ( at_ms - now > IPERF_SYNC_SPIN_MS ) {
+        mico_thread_msleep( (uint32_t) (at_ms - now - IPERF_SYNC_SPIN_MS) );
+    }
+
+    do {
+        mico_time_get_utc_time_ms( &now );
+    } while ( now < at_ms );
+
+    printf( "Start skew = %u ms\r\n", (unsigned) (now - at_ms) );
+}
+
+static OSStatus iperf_sync_wait_trigger( uint32_t timeout_ms )
+{
+    int sockfd;
+    struct sockaddr_in addr;
+    iperf_sync_trigger_t trigger;
+    mico_utc_time_ms_t now, sent_ms;
+    uint32_t start = mico_rtos_get_time( );
+    uint32_t elapsed, timeout;
+    int nbytes;
+
+    if ( (sockfd = socket( AF_INET, SOCK_DGRAM, 0 )) < 0 ) {
+        return kNoResourcesErr;
+    }
+
+    memset( &addr, 0, sizeof(addr) );
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl( INADDR_ANY );
+    addr.sin_port = htons( IPERF_SYNC_TRIGGER_PORT );
+    if ( bind( sockfd, (struct sockaddr *) &addr, sizeof(addr) ) < 0 ) {
+        close( sockfd );
+        return kGeneralErr;
+    }
+
+    printf( "Waiting for trigger on UDP port %d...\r\n", IPERF_SYNC_TRIGGER_PORT );
+    do {
+        /* Other datagrams on the port do not restart the wait */
+        if ( timeout_ms != 0 ) {
+            elapsed = mico_rtos_get_time( ) - start;
+            if ( elapsed >= timeout_ms ) {
+                close( sockfd );
+                printf( "No trigger within %u ms\r\n", (unsigned) timeout_ms );
+                return kTimeoutErr;
+            }
+            timeout = timeout_ms - elapsed;
+            setsockopt( sockfd, SOL_SOCKET, SO_RCVTIMEO, (char *) &timeout, sizeof(timeout) );
+        }
+        nbytes = recv( sockfd, &trigger, sizeof(trigger), 0 );
+    } while ( nbytes < (int) sizeof(trigger.magic)
+              || memcmp( trigger.magic, IPERF_SYNC_TRIGGER_MAGIC, sizeof(trigger.magic) ) != 0 );
+    mico_time_get_utc_time_ms( &now );
+    close( sockfd );
+
+    if ( nbytes == sizeof(trigger) ) {
+        sent_ms = ((uint64_t) ntohl( trigger.sent_ms_hi ) << 32) | ntohl( trigger.sent_ms_lo );
+        if ( sent_ms != 0 ) {
+            printf( "Start skew = %d ms (trigger sent to received)\r\n", (int) (int64_t) (now - sent_ms) );
+        }
+    }
+    printf( "Triggered\r\n" );
+    return kNoErr;
+}
+
+OSStatus iperf_sync_wait( const iperf_sync_t *sync )
+{
+    OSStatus err = kNoErr;
+
+    if ( sync->ntp_server != 0 ) {
+        err = iperf_sync_ntp( sync->ntp_server );
+        require_noerr( err, exit );
+    }
+
+    switch ( sync->mode )
+    {
+        case IPERF_SYNC_AT:
+            iperf_sync_wait_at( sync->at_ms );
+            break;
+        case IPERF_SYNC_TRIGGER:
+            err = iperf_sync_wait_trigger( sync->timeout_ms );
+            break;
+        case IPERF_SYNC_NONE:
+        default:
+            break;
+    }
+
+exit:
+    return err;
+}
@@ -0,0 +1,93 @@
+/* MiCO Team
+ * Copyright (c) 2017 MXCHIP Information Tech. Co.,Ltd
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/******************************************************
+ *                    Constants
+ ******************************************************/
+
+#define IPERF_SYNC_TRIGGER_PORT     (5002)
+#define IPERF_SYNC_TRIGGER_MAGIC    "IPRF"
+
+/* wake up this early from the coarse sleep and spin on the clock */
+#define IPERF_SYNC_SPIN_MS          (20)
+
+/* give up on the trigger after this long, unless "--trigger-timeout" says
+ * otherwise; long enough to arm a fleet of boards one by one */
+#define IPERF_SYNC_TRIGGER_TIMEOUT_S (600)
+
+/******************************************************
+ *                   Enumerations
+ ******************************************************/
+
+typedef enum
+{
+    IPERF_SYNC_NONE = 0,
+    IPERF_SYNC_AT,      /* "--at <epoch_ms>" */
+    IPERF_SYNC_TRIGGER, /* "--on-trigger" */
+} iperf_sync_mode_t;
+
+/******************************************************
+ *                    Structures
+ ******************************************************/
+
+/*
+ * Trigger datagram, broadcast to IPERF_SYNC_TRIGGER_PORT by the test
+ * controller. "sent_ms" is the sender's UTC time in ms (big endian), or 0
+ * if the sender has no synchronized clock.
+ */
+typedef struct iperf_sync_trigger_s
+{
+    char magic[4];
+    uint32_t sent_ms_hi;
+    uint32_t sent_ms_lo;
+} iperf_sync_trigger_t;
+
+typedef struct iperf_sync_s
+{
+    iperf_sync_mode_t mode;
+    uint64_t at_ms;      /* UTC start time for IPERF_SYNC_AT */
+    uint32_t ntp_server; /* optional SNTP server, network byte order */
+    uint32_t timeout_ms; /* longest wait for the trigger, 0 for no limit */
+} iperf_sync_t;
+
+/******************************************************
+ *               Function Declarations
+ ******************************************************/
+
+/**
+  * @brief  Block until the scheduled start time or the trigger packet.
+  *         Call it once the socket is connected and the buffers are ready.
+  * @param  sync: start condition parsed from the command line.
+  * @retval kNoErr is returned on success, otherwise, kXXXErr is returned.
+  */
+OSStatus iperf_sync_wait( const iperf_sync_t *sync );
+
+/**
+  * @brief  Set the UTC clock from an SNTP server.
+  * @param  server: IPv4 address of the server, network byte order.
+  * @retval kNoErr is returned on success, otherwise, kXXXErr is returned.
+  */
+OSStatus iperf_sync_ntp( uint32_t server );
+
+#ifdef __cplusplus
+} /*extern "C" */
+#endif
@@ -18,6 +18,10 @@
 
 #include "iperf_task.h"
 #include "iperf_debug.h"
+#include "iperf_latency.h"
+#include "iperf_sync.h"
+
+#include "us_ticker_api.h"
 
 /******************************************************
  *                      Macros
@@ -45,6 +49,11 @@
 #define IPERF_DEFAULT_UDP_RATE (1024 * 1024)
 #define IPERF_TEST_BUFFER_SIZE (2048)
 
+/* TCP pacing: sleep when the next write is this far away, spin below it */
+#define IPERF_PACE_SLEEP_US     (2000)
+/* TCP pacing: how far the schedule may fall behind before it is reset */
+#define IPERF_PACE_MAX_BURST_US (10000)
+
 #define IPERF_DEBUG_RECEIVE     (1<<0)
 #define IPERF_DEBUG_SEND        (1<<1)
 #define IPERF_DEBUG_REPORT      (1<<2)
@@ -58,15 +67,6 @@
  ******************************************************/
 
 // Private typedef -------------------------------------------------------------
-typedef struct count_s
-{
-    unsigned Bytes;
-    unsigned KBytes;
-    unsigned MBytes;
-    unsigned GBytes;
-    unsigned times;
-} count_t;
-
 // used to reference the 4 byte ID number we place in UDP datagrams
 // use int32_t if possible, otherwise a 32 bit bitfield (e.g. on J90)
 typedef struct UDP_datagram
@@ -142,13 +142,6 @@ typedef struct server_hdr
  *               Function Declarations
  ******************************************************/
 
-count_t iperf_calculate_result( int pkt_size, count_t pkt_count, int need_to_convert );
-void iperf_display_report( char *report_title, unsigned time, unsigned h_ms_time, count_t pkt_count );
-count_t iperf_reset_count( count_t pkt_count );
-count_t iperf_copy_count( count_t pkt_count, count_t tmp_count );
-count_t iperf_diff_count( count_t pkt_count, count_t tmp_count );
-int iperf_format_transform( char *param );
-
 /******************************************************
  *               Variables Definitions
  ******************************************************/
@@ -158,6 +151,9 @@ int g_iperf_is_tradeoff_test_client = 0;
 int g_iperf_is_tradeoff_test_server = 0;
 uint32_t g_iperf_server_addr = 0;
 
+/* Read-only TCP payload for "-F", kept in flash so nothing is staged in RAM */
+static const char iperf_flash_payload[MAX_WIN_SIZE] = { 0 };
+
 /******************************************************
  *               Function Definitions
  ******************************************************/
@@ -184,6 +180,8 @@ void iperf_udp_run_server( char *parameters[] )
     int tmp = 0;
 #endif
     char *buffer = (char*) malloc( IPERF_TEST_BUFFER_SIZE );
+    iperf_latency_t *lat = (iperf_latency_t*) malloc( sizeof(iperf_latency_t) );
+    uint32_t lat_start;
     
     uint32_t t1, t2, curr_t, curr_h_ms, t2_h_ms, t1_h_ms, tmp_t, tmp_h_ms, offset_t1, offset_t2, offset_time;
     UDP_datagram *udp_h;
@@ -196,6 +194,7 @@ void iperf_udp_run_server( char *parameters[] )
 
     memset( buffer, 0, IPERF_TEST_BUFFER_SIZE );
     //Statistics init
+    iperf_latency_init( lat );
     pkt_count = iperf_reset_count( pkt_count );
     tmp_count = iperf_reset_count( tmp_count );
     server_port = 0;
@@ -276,8 +275,10 @@ void iperf_udp_run_server( char *parameters[] )
         // Handles request
         do {
             iperf_get_current_time( &offset_t1, 0 );
+            lat_start = iperf_latency_start( );
             nbytes = recvfrom( sockfd, buffer, IPERF_TEST_BUFFER_SIZE, 0, (struct sockaddr *) &cliaddr,
                                (socklen_t *) &cli_len );
+            iperf_latency_record( lat, lat_start );
             iperf_get_current_time( &offset_t2, 0 );
 
             //if connected to iperf v2.0.1, there is no end package sent from client side
@@ -391,6 +392,7 @@ void iperf_udp_run_server( char *parameters[] )
                 }
                 // print out result
                 iperf_display_report( "[Total]UDP Server", t2, t2_h_ms, pkt_count );
+                iperf_latency_report( "recvfrom", lat );
 
                 //TODO: need to send the correct report to client-side, flag = 0 means the report is ignored.
                 if ( udp_h_id < 0 ) {
@@ -444,6 +446,7 @@ void iperf_udp_run_server( char *parameters[] )
         free( parameters );
     }
     free( buffer );
+    free( lat );
     // For tradeoff mode, task will be deleted in iperf_udp_run_client
     if ( g_iperf_is_tradeoff_test_client == 0 ) {
         mico_rtos_delete_thread( NULL );
@@ -469,11 +472,14 @@ void iperf_tcp_run_server( char *parameters[] )
     uint32_t t1, t2, curr_t;
     int offset = IPERF_COMMAND_BUFFER_SIZE / sizeof(char *);
     char *buffer = (char*) malloc( IPERF_TEST_BUFFER_SIZE );
+    iperf_latency_t *lat = (iperf_latency_t*) malloc( sizeof(iperf_latency_t) );
+    uint32_t lat_start;
     uint32_t timeout;
     timeout = 20 * 1000; //set recvive timeout = 20(sec)
 
     memset( buffer, 0, IPERF_TEST_BUFFER_SIZE );
     //Statistics init
+    iperf_latency_init( lat );
     pkt_count = iperf_reset_count( pkt_count );
     tmp_count = iperf_reset_count( tmp_count );
     server_port = 0;
@@ -550,7 +556,9 @@ void iperf_tcp_run_server( char *parameters[] )
 
                 //Connection
                 do {
+                    lat_start = iperf_latency_start( );
                     nbytes = recv( connfd, buffer, IPERF_TEST_BUFFER_SIZE, 0 );
+                    iperf_latency_record( lat, lat_start );
                     pkt_count = iperf_calculate_result( nbytes, pkt_count, 0 );
                     if ( pkt_count.times == 1 ) {
                         iperf_get_current_time( &t1, 0 );
@@ -591,8 +599,10 @@ void iperf_tcp_run_server( char *parameters[] )
                 printf( "\r\nClose socket!\r\n" );
                 //Get report
                 iperf_display_report( "[Total]TCP Server", t2 - t1, 0, pkt_count );
+                iperf_latency_report( "recv", lat );
 
                 //Statistics init
+                iperf_latency_init( lat );
                 pkt_count = iperf_reset_count( pkt_count );
                 tmp_count = iperf_reset_count( tmp_count );
                 if ( interval_tag > 0 ) {
@@ -617,6 +627,7 @@ void iperf_tcp_run_server( char *parameters[] )
         free( parameters );
     }
     free( buffer );
+    free( lat );
     mico_rtos_delete_thread( NULL );
 
 }
@@ -633,17 +644,27 @@ void iperf_tcp_run_client( char *parameters[] )
     int num_tag = 0; /* the tag of parameter "-n"  */
     int interval_tag = 0; /* the tag of parameter "-i"  */
     int i;
-    int win_size, send_time, server_port, pkt_delay, tos;
+    int win_size, send_time, server_port, pkt_delay, tos, bw;
     uint32_t t1, t2, curr_t;
+    uint32_t pace_due = 0; /* us_ticker time of the next paced write */
+    int flash_src = 0; /* the tag of parameter "-F" */
+    const char *src;
+    unsigned short_writes = 0, tmp_short_writes = 0;
     int offset = IPERF_COMMAND_BUFFER_SIZE / sizeof(char *);
     char *buffer = (char*) malloc( IPERF_TEST_BUFFER_SIZE );
+    iperf_latency_t *lat = (iperf_latency_t*) malloc( sizeof(iperf_latency_t) );
+    uint32_t lat_start;
+    iperf_sync_t sync;
     pkt_count = iperf_reset_count( pkt_count );
     tmp_count = iperf_reset_count( tmp_count );
+    memset( &sync, 0, sizeof(sync) );
+    sync.timeout_ms = IPERF_SYNC_TRIGGER_TIMEOUT_S * 1000;
     win_size = 0;
     send_time = 0;
     server_port = 0;
     pkt_delay = 0;
     tos = 0;
+    bw = 0;
     memset( buffer, 0, IPERF_TEST_BUFFER_SIZE );
     //Handle input parameters
     Server_IP = (char *) &parameters[0];
@@ -694,10 +715,39 @@ void iperf_tcp_run_client( char *parameters[] )
             i++;
             tos = atoi( (char *) &parameters[i * offset] );
             printf( "Set TOS = %d \r\n", atoi( (char *) &parameters[i * offset] ) );
+        } else if ( strcmp( (char *) &parameters[i * offset], "-b" ) == 0 )
+                    {
+            i++;
+            bw = iperf_format_transform( (char *) &parameters[i * offset] );
+            printf( "Set bandwidth = %d bits/sec\r\n", bw );
+        } else if ( strcmp( (char *) &parameters[i * offset], "-F" ) == 0 )
+                    {
+            flash_src = 1;
+            printf( "Send from the read-only flash payload\r\n" );
         } else if ( strcmp( (char *) &parameters[i * offset], "-i" ) == 0 )
                     {
             interval_tag = 1;
             printf( "Set 10 seconds between periodic bandwidth reports\r\n" );
+        } else if ( strcmp( (char *) &parameters[i * offset], "--at" ) == 0 )
+                    {
+            i++;
+            sync.mode = IPERF_SYNC_AT;
+            sync.at_ms = strtoull( (char *) &parameters[i * offset], NULL, 10 );
+            printf( "Set start time = %s (epoch ms)\r\n", (char *) &parameters[i * offset] );
+        } else if ( strcmp( (char *) &parameters[i * offset], "--on-trigger" ) == 0 )
+                    {
+            sync.mode = IPERF_SYNC_TRIGGER;
+            printf( "Set start on trigger packet\r\n" );
+        } else if ( strcmp( (char *) &parameters[i * offset], "--trigger-timeout" ) == 0 )
+                    {
+            i++;
+            sync.timeout_ms = atoi( (char *) &parameters[i * offset] ) * 1000;
+            printf( "Set trigger timeout = %s (secs)\r\n", (char *) &parameters[i * offset] );
+        } else if ( strcmp( (char *) &parameters[i * offset], "--ntp" ) == 0 )
+                    {
+            i++;
+            sync.ntp_server = inet_addr( (char *) &parameters[i * offset] );
+            printf( "Set SNTP server = %s\r\n", (char *) &parameters[i * offset] );
         }
     }
 
@@ -706,6 +756,20 @@ void iperf_tcp_run_client( char *parameters[] )
         win_size = 1460;
         printf( "Default window size = %d Bytes\r\n", win_size );
     }
+
+    if ( flash_src == 1 ) {
+        /* The socket reads straight from flash, its copy into pbufs is the only one */
+        free( buffer );
+        buffer = NULL;
+        src = iperf_flash_payload;
+    } else {
+        if ( win_size > IPERF_TEST_BUFFER_SIZE ) {
+            free( buffer );
+            buffer = (char*) malloc( win_size );
+            memset( buffer, 0, win_size );
+        }
+        src = buffer;
+    }
     if ( send_time == 0 )
          {
         if ( num_tag == 1 )
@@ -723,6 +787,8 @@ void iperf_tcp_run_client( char *parameters[] )
     if ( (sockfd = socket( AF_INET, SOCK_STREAM, 0 )) < 0 )
          {
         printf( "[%s:%d] sockfd = %d\r\n", __FUNCTION__, __LINE__, sockfd );
+        free( buffer );
+        free( lat );
         if ( parameters ) {
             free( parameters );
         }
@@ -749,6 +815,19 @@ void iperf_tcp_run_client( char *parameters[] )
         printf( "Connect failed, sockfd is %d, addr is \"%s\"\r\n", (int) sockfd,
                 ((struct sockaddr *) &servaddr)->sa_data );
         close( sockfd );
+        free( buffer );
+        free( lat );
+        if ( parameters ) {
+            free( parameters );
+        }
+        mico_rtos_delete_thread( NULL );
+    }
+
+    if ( iperf_sync_wait( &sync ) != kNoErr ) {
+        printf( "Synchronized start failed\r\n" );
+        close( sockfd );
+        free( buffer );
+        free( lat );
         if ( parameters ) {
             free( parameters );
         }
@@ -756,13 +835,30 @@ void iperf_tcp_run_client( char *parameters[] )
     }
 
     iperf_get_current_time( &t1, 0 );
+    iperf_latency_init( lat );
+    pace_due = us_ticker_read( );
 
     do {
-        nbytes = send( sockfd, buffer, win_size, 0 );
+        if ( bw > 0 ) {
+            iperf_pace_wait( pace_due );
+        }
+        lat_start = iperf_latency_start( );
+        nbytes = send( sockfd, src, win_size, 0 );
+        iperf_latency_record( lat, lat_start );
         pkt_count = iperf_calculate_result( nbytes, pkt_count, 0 );
 #if defined(MICO_IPERF_DEBUG_ENABLE)
         DBGPRINT_IPERF(IPERF_DEBUG_SEND, ("\r\n[%s:%d] nbytes=%d \r\n", __FUNCTION__, __LINE__, nbytes));
 #endif
+        if ( nbytes >= 0 && nbytes < win_size ) {
+            short_writes++;
+        }
+        if ( bw > 0 && nbytes > 0 ) {
+            /* Schedule the next write by what actually went out */
+            pace_due += (uint32_t) ((uint64_t) nbytes * 8 * 1000000 / bw);
+            if ( (int32_t) (us_ticker_read( ) - pace_due) > IPERF_PACE_MAX_BURST_US ) {
+                pace_due = us_ticker_read( ) - IPERF_PACE_MAX_BURST_US;
+            }
+        }
         mico_thread_msleep( pkt_delay );
 
         if ( num_tag == 1 )
@@ -782,7 +878,9 @@ void iperf_tcp_run_client( char *parameters[] )
                 printf( "\r\nInterval: %d - %d sec   ", (int) (curr_t - t1) / 10 * 10 - 10,
                         (int) (curr_t - t1) / 10 * 10 );
                 iperf_display_report( "TCP Client", 10, 0, iperf_diff_count( pkt_count, tmp_count ) );
+                printf( "Short writes: %u\r\n", short_writes - tmp_short_writes );
                 tmp_count = iperf_copy_count( pkt_count, tmp_count );
+                tmp_short_writes = short_writes;
                 interval_tag++;
             }
         }
@@ -795,7 +893,14 @@ void iperf_tcp_run_client( char *parameters[] )
     close( sockfd );
     printf( "\r\nClose socket!\r\n" );
     free( buffer );
-    iperf_display_report( "[Total]TCP Client", t2 - t1, 0, pkt_count );
+    iperf_display_report( flash_src ? "[Total]TCP Client (flash source)" : "[Total]TCP Client (RAM source)",
+                          t2 - t1, 0, pkt_count );
+    if ( bw > 0 ) {
+        printf( "Target bandwidth: %d bits/sec\r\n", bw );
+    }
+    printf( "Short writes: %u\r\n\r\n", short_writes );
+    iperf_latency_report( "send", lat );
+    free( lat );
 
     if ( parameters )
     {
@@ -825,6 +930,9 @@ void iperf_udp_run_client( char *parameters[] )
     int udp_h_id = 0;
     int offset = IPERF_COMMAND_BUFFER_SIZE / sizeof(char *);
     char *buffer = (char*) malloc( IPERF_TEST_BUFFER_SIZE );
+    iperf_latency_t *lat = (iperf_latency_t*) malloc( sizeof(iperf_latency_t) );
+    uint32_t lat_start;
+    iperf_sync_t sync;
     // test data init
     for ( i = 0; i < IPERF_TEST_BUFFER_SIZE; i++ ) {
         buffer[i] = (i % 10 + '0');
@@ -840,6 +948,8 @@ void iperf_udp_run_client( char *parameters[] )
     pkt_delay_offset = 0;
     tos = 0;
     bw = 2621440;
+    memset( &sync, 0, sizeof(sync) );
+    sync.timeout_ms = IPERF_SYNC_TRIGGER_TIMEOUT_S * 1000;
 
     //Handle input parameters
     if ( g_iperf_is_tradeoff_test_server == 0 ) {
@@ -884,6 +994,22 @@ void iperf_udp_run_client( char *parameters[] )
             } else if ( strcmp( (char *) &parameters[i * offset], "-r" ) == 0 ) {
                 tradeoff_tag = 1;
                 printf( "Set to tradeoff mode\r\n" );
+            } else if ( strcmp( (char *) &parameters[i * offset], "--at" ) == 0 ) {
+                i++;
+                sync.mode = IPERF_SYNC_AT;
+                sync.at_ms = strtoull( (char *) &parameters[i * offset], NULL, 10 );
+                printf( "Set start time = %s (epoch ms)\r\n", (char *) &parameters[i * offset] );
+            } else if ( strcmp( (char *) &parameters[i * offset], "--on-trigger" ) == 0 ) {
+                sync.mode = IPERF_SYNC_TRIGGER;
+                printf( "Set start on trigger packet\r\n" );
+            } else if ( strcmp( (char *) &parameters[i * offset], "--trigger-timeout" ) == 0 ) {
+                i++;
+                sync.timeout_ms = atoi( (char *) &parameters[i * offset] ) * 1000;
+                printf( "Set trigger timeout = %s (secs)\r\n", (char *) &parameters[i * offset] );
+            } else if ( strcmp( (char *) &parameters[i * offset], "--ntp" ) == 0 ) {
+                i++;
+                sync.ntp_server = inet_addr( (char *) &parameters[i * offset] );
+                printf( "Set SNTP server = %s\r\n", (char *) &parameters[i * offset] );
             }
         }
     }
@@ -915,6 +1041,8 @@ void iperf_udp_run_client( char *parameters[] )
     // Create a new TCP connection handle
     if ( (sockfd = socket( AF_INET, SOCK_DGRAM, 0 )) < 0 ) {
         printf( "[%s:%d] sockfd = %d\r\n", __FUNCTION__, __LINE__, sockfd );
+        free( buffer );
+        free( lat );
         if ( parameters ) {
             free( parameters );
         }
@@ -947,6 +1075,8 @@ void iperf_udp_run_client( char *parameters[] )
     if ( (connect( sockfd, (struct sockaddr *) &servaddr, sizeof(servaddr) )) < 0 ) {
         printf( "Connect failed\r\n" );
         close( sockfd );
+        free( buffer );
+        free( lat );
         if ( parameters ) {
             free( parameters );
         }
@@ -972,7 +1102,19 @@ void iperf_udp_run_client( char *parameters[] )
         client_h->amount &= htonl( 0x7FFFFFFF );
     }
 
+    if ( iperf_sync_wait( &sync ) != kNoErr ) {
+        printf( "Synchronized start failed\r\n" );
+        close( sockfd );
+        free( buffer );
+        free( lat );
+        if ( parameters ) {
+            free( parameters );
+        }
+        mico_rtos_delete_thread( NULL );
+    }
+
     iperf_get_current_time( &t1, &t1_ms );
+    iperf_latency_init( lat );
     last_tick = t1_ms;
     last_sleep = 0;
 
@@ -983,7 +1125,9 @@ void iperf_udp_run_client( char *parameters[] )
 
         udp_h_id++;
 
+        lat_start = iperf_latency_start( );
         nbytes = send( sockfd, buffer, data_size, 0 );
+        iperf_latency_record( lat, lat_start );
         pkt_count = iperf_calculate_result( nbytes, pkt_count, 0 );
 
         iperf_get_current_time( &curr_t, &current_tick );
@@ -1035,6 +1179,7 @@ void iperf_udp_run_client( char *parameters[] )
 
     iperf_get_current_time( &t2, 0 );
     iperf_display_report( "[Total]UDP Client", t2 - t1, 0, pkt_count );
+    iperf_latency_report( "send", lat );
 
     // send the last datagram
     udp_h_id = (-udp_h_id);
@@ -1063,6 +1208,7 @@ void iperf_udp_run_client( char *parameters[] )
     }
 
     free( buffer );
+    free( lat );
     // For tradeoff mode, task will be deleted in iperf_udp_run_server
     if ( g_iperf_is_tradeoff_test_server == 0 ) {
         mico_rtos_delete_thread( NULL );
@@ -1233,6 +1379,20 @@ count_t iperf_diff_count( count_t pkt_count, count_t tmp_count )
     return tmp_count;
 }
 
+/* Sleep with the RTOS tick while the write is far away, then spin to the exact us */
+void iperf_pace_wait( uint32_t due_us )
+{
+    int32_t remain = (int32_t) (due_us - us_ticker_read( ));
+
+    if ( remain >= IPERF_PACE_SLEEP_US ) {
+        mico_thread_msleep( remain / 1000 - 1 );
+    }
+
+    while ( (int32_t) (due_us - us_ticker_read( )) > 0 ) {
+        mico_rtos_thread_yield( );
+    }
+}
+
 void iperf_get_current_time( uint32_t *s, uint32_t *ms )
 {
     uint32_t time_ms;
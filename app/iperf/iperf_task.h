@@ -40,6 +40,15 @@
  *                 Type Definitions
  ******************************************************/
 
+typedef struct count_s
+{
+    unsigned Bytes;
+    unsigned KBytes;
+    unsigned MBytes;
+    unsigned GBytes;
+    unsigned times;
+} count_t;
+
 /******************************************************
  *                    Structures
  ******************************************************/
@@ -54,4 +63,12 @@ void iperf_udp_run_client(char *parameters[]);
 void iperf_tcp_run_client(char *parameters[]);
 
 void iperf_get_current_time(uint32_t *s, uint32_t *ms);
+void iperf_pace_wait(uint32_t due_us);
+
+count_t iperf_calculate_result( int pkt_size, count_t pkt_count, int need_to_convert );
+void iperf_display_report( char *report_title, unsigned time, unsigned h_ms_time, count_t pkt_count );
+count_t iperf_reset_count( count_t pkt_count );
+count_t iperf_copy_count( count_t pkt_count, count_t tmp_count );
+count_t iperf_diff_count( count_t pkt_count, count_t tmp_count );
+int iperf_format_transform( char *param );
 
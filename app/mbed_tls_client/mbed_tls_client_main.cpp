@@ -33,10 +33,19 @@
 #define DEBUG_LEVEL 0
 
 #include "mbed.h"
+#include "mbed_stats.h"
 #include "NetworkStack.h"
 
 #include "EMW10xxInterface.h"
 #include "TCPSocket.h"
+#include "DnsCache.h"
+#include "TlsSessionCache.h"
+#include "TlsEnvironment.h"
+#include "TlsConnection.h"
+#include "HttpsResponseReader.h"
+#include "HttpsClient.h"
+#include "TlsSocketBio.h"
+#include "SocketReactor.h"
 
 #include "mbedtls/platform.h"
 #include "mbedtls/ssl.h"
@@ -62,6 +71,16 @@ const size_t HTTPS_PATH_LEN = sizeof(HTTPS_PATH) - 1;
 const char *HTTPS_OK_STR = "200 OK";
 const char *HTTPS_HELLO_STR = "Hello world!";
 
+/* Connections made, the first one is a full handshake, the others offer its session */
+const int HTTPS_RUNS = 4;
+
+/* Fetches run side by side from one thread by the non-blocking client */
+const int HTTPS_PARALLEL = 2;
+const int HTTPS_PARALLEL_TIMEOUT_MS = 30000;
+
+/* Thread refreshing DNS entries close to expiry, gethostbyname() needs the stack */
+const uint32_t DNS_PREFETCH_STACK = 2048;
+
 /* personalization string for the drbg */
 const char *DRBG_PERS = "mbed TLS helloword client";
 
@@ -106,33 +125,35 @@ public:
      *
      * @param[in] domain The domain name to fetch from
      * @param[in] port The port of the HTTPS server
+     * @param[in] tls Initialized TLS environment the connection is set up on
+     * @param[in] dns Cache the domain is resolved through, may be NULL
+     * @param[in] sessions Cache of TLS sessions to resume, may be NULL
      */
-    HelloHTTPS(const char * domain, const uint16_t port, NetworkInterface *net_iface) :
-            _domain(domain), _port(port)
+    HelloHTTPS(const char * domain, const uint16_t port, NetworkInterface *net_iface, TlsEnvironment *tls,
+               DnsCache *dns = NULL, TlsSessionCache *sessions = NULL) :
+            _domain(domain), _port(port), _tls(tls), _dns(dns), _sessions(sessions)
     {
 
         _error = false;
         _gothello = false;
         _got200 = false;
         _bpos = 0;
+        _echoed = 0;
+        _hello_match = 0;
         _request_sent = 0;
+        _resumed = false;
+        _handshake_ms = 0;
+        _setup_us = 0;
         _tcpsocket = new TCPSocket(net_iface);
 
-        mbedtls_entropy_init(&_entropy);
-        mbedtls_ctr_drbg_init(&_ctr_drbg);
-        mbedtls_x509_crt_init(&_cacert);
         mbedtls_ssl_init(&_ssl);
-        mbedtls_ssl_config_init(&_ssl_conf);
     }
     /**
      * HelloHTTPS Desctructor
      */
     ~HelloHTTPS() {
-        mbedtls_entropy_free(&_entropy);
-        mbedtls_ctr_drbg_free(&_ctr_drbg);
-        mbedtls_x509_crt_free(&_cacert);
         mbedtls_ssl_free(&_ssl);
-        mbedtls_ssl_config_free(&_ssl_conf);
+        delete _tcpsocket;
     }
     /**
      * Start the test.
@@ -149,92 +170,88 @@ public:
         _error = false;
         _disconnected = false;
         _request_sent = false;
+        _echoed = 0;
+        _hello_match = 0;
         /* Fill the request buffer */
-        _bpos = snprintf(_buffer, sizeof(_buffer) - 1, "GET %s HTTP/1.1\nHost: %s\n\n", path, HTTPS_SERVER_NAME);
+        _bpos = snprintf(_buffer, sizeof(_buffer) - 1, "GET %s HTTP/1.1\r\nHost: %s\r\n\r\n", path, HTTPS_SERVER_NAME);
 
         /*
-         * Initialize TLS-related stuf.
+         * Set up the connection, entropy, DRBG, CA chain and config are
+         * shared and were initialized once by the TLS environment.
          */
         int ret;
-        if ((ret = mbedtls_ctr_drbg_seed(&_ctr_drbg, mbedtls_entropy_func, &_entropy,
-                          (const unsigned char *) DRBG_PERS,
-                          sizeof (DRBG_PERS))) != 0) {
-            print_mbedtls_error("mbedtls_crt_drbg_init", ret);
-            _error = true;
-            return;
-        }
-
-        if ((ret = mbedtls_x509_crt_parse(&_cacert, (const unsigned char *) SSL_CA_PEM,
-                           sizeof (SSL_CA_PEM))) != 0) {
-            print_mbedtls_error("mbedtls_x509_crt_parse", ret);
-            _error = true;
-            return;
-        }
-
-        if ((ret = mbedtls_ssl_config_defaults(&_ssl_conf,
-                        MBEDTLS_SSL_IS_CLIENT,
-                        MBEDTLS_SSL_TRANSPORT_STREAM,
-                        MBEDTLS_SSL_PRESET_DEFAULT)) != 0) {
-            print_mbedtls_error("mbedtls_ssl_config_defaults", ret);
-            _error = true;
-            return;
-        }
-
-        mbedtls_ssl_conf_ca_chain(&_ssl_conf, &_cacert, NULL);
-        mbedtls_ssl_conf_rng(&_ssl_conf, mbedtls_ctr_drbg_random, &_ctr_drbg);
-
-        /* It is possible to disable authentication by passing
-         * MBEDTLS_SSL_VERIFY_NONE in the call to mbedtls_ssl_conf_authmode()
-         */
-        mbedtls_ssl_conf_authmode(&_ssl_conf, MBEDTLS_SSL_VERIFY_REQUIRED);
-
 #if DEBUG_LEVEL > 0
-        mbedtls_ssl_conf_verify(&_ssl_conf, my_verify, NULL);
-        mbedtls_ssl_conf_dbg(&_ssl_conf, my_debug, NULL);
+        mbedtls_ssl_conf_verify(_tls->config(), my_verify, NULL);
+        mbedtls_ssl_conf_dbg(_tls->config(), my_debug, NULL);
         mbedtls_debug_set_threshold(DEBUG_LEVEL);
 #endif
 
-        if ((ret = mbedtls_ssl_setup(&_ssl, &_ssl_conf)) != 0) {
+        Timer setup_timer;
+        setup_timer.start();
+        if ((ret = _tls->setup(&_ssl, HTTPS_SERVER_NAME)) != 0) {
             print_mbedtls_error("mbedtls_ssl_setup", ret);
             _error = true;
             return;
         }
+        _setup_us = setup_timer.read_us();
 
-        mbedtls_ssl_set_hostname(&_ssl, HTTPS_SERVER_NAME);
+        TlsSessionCache::Offer offer;
+        bool offered = _sessions && _sessions->offer(&_ssl, _domain, _port, &offer);
 
         mbedtls_ssl_set_bio(&_ssl, static_cast<void *>(_tcpsocket),
-                                   ssl_send, ssl_recv, NULL );
+                                   TlsSocketBio::send, TlsSocketBio::recv, NULL );
 
 
         /* Connect to the server */
         mbedtls_printf("Connecting with %s\r\n", _domain);
-        ret = _tcpsocket->connect(_domain, _port);
+        if (_dns) {
+            ret = _dns->connect(_tcpsocket, _domain, _port);
+        } else {
+            ret = _tcpsocket->connect(_domain, _port);
+        }
         if (ret != NSAPI_ERROR_OK) {
             mbedtls_printf("Failed to connect\r\n");
             onError(_tcpsocket, -1);
             return;
         }
 
-       /* Start the handshake, the rest will be done in onReceive() */
-        mbedtls_printf("Starting the TLS handshake...\r\n");
-        ret = mbedtls_ssl_handshake(&_ssl);
+       /* Run the handshake, the socket blocks so WANT_READ/WANT_WRITE
+        * only mean a step has to be repeated */
+        mbedtls_printf("Starting the TLS handshake%s...\r\n", offered ? ", offering the cached session" : "");
+        Timer handshake_timer;
+        handshake_timer.start();
+        do {
+            ret = mbedtls_ssl_handshake(&_ssl);
+        } while (ret == MBEDTLS_ERR_SSL_WANT_READ || ret == MBEDTLS_ERR_SSL_WANT_WRITE);
+        _handshake_ms = handshake_timer.read_ms();
         if (ret < 0) {
-            if (ret != MBEDTLS_ERR_SSL_WANT_READ &&
-                ret != MBEDTLS_ERR_SSL_WANT_WRITE) {
-                print_mbedtls_error("mbedtls_ssl_handshake", ret);
-                onError(_tcpsocket, -1 );
+            print_mbedtls_error("mbedtls_ssl_handshake", ret);
+            if (offered) {
+                /* Do not offer a session the server chokes on again */
+                _sessions->forget(_domain, _port);
             }
+            onError(_tcpsocket, -1 );
             return;
         }
 
-        ret = mbedtls_ssl_write(&_ssl, (const unsigned char *) _buffer, _bpos);
-        if (ret < 0) {
-            if (ret != MBEDTLS_ERR_SSL_WANT_READ &&
-                ret != MBEDTLS_ERR_SSL_WANT_WRITE) {
+        if (_sessions && _sessions->save(&_ssl, _domain, _port, &offer) == 0) {
+            _resumed = offer.resumed;
+        }
+        mbedtls_printf("TLS handshake: %lu ms, %s\r\n", (unsigned long)_handshake_ms,
+                       _resumed ? "resumed" : "full");
+
+        /* mbedtls_ssl_write may take less than asked, send the rest too */
+        for (size_t sent = 0; sent < _bpos; ) {
+            ret = mbedtls_ssl_write(&_ssl, (const unsigned char *) _buffer + sent, _bpos - sent);
+            if (ret == MBEDTLS_ERR_SSL_WANT_READ || ret == MBEDTLS_ERR_SSL_WANT_WRITE) {
+                continue;
+            }
+            if (ret < 0) {
                 print_mbedtls_error("mbedtls_ssl_write", ret);
                 onError(_tcpsocket, -1 );
+                return;
             }
-            return;
+            sent += ret;
         }
 
         /* It also means the handshake is done, time to print info */
@@ -256,30 +273,24 @@ public:
             printf("Certificate verification passed\r\n\r\n");
 
 
-        /* Read data out of the socket */
-        ret = mbedtls_ssl_read(&_ssl, (unsigned char *) _buffer, sizeof(_buffer));
-        if (ret < 0) {
-            if (ret != MBEDTLS_ERR_SSL_WANT_READ && ret != MBEDTLS_ERR_SSL_WANT_WRITE) {
-                print_mbedtls_error("mbedtls_ssl_read", ret);
-                onError(_tcpsocket, -1 );
-            }
+        /* Stream the response, the body arrives record by record */
+        mbedtls_printf("HTTPS: Received message:\r\n\r\n");
+        int status = _reader.read(&_ssl, callback(this, &HelloHTTPS::on_body));
+        if (status < 0) {
+            print_mbedtls_error("HttpsResponseReader::read", status);
+            onError(_tcpsocket, -1 );
             delete[] buf;
             return;
         }
-        _bpos = static_cast<size_t>(ret);
-
-        _buffer[_bpos] = 0;
-
-        /* Check each of the flags */
-        _got200 = _got200 || strstr(_buffer, HTTPS_OK_STR) != NULL;
-        _gothello = _gothello || strstr(_buffer, HTTPS_HELLO_STR) != NULL;
+        _got200 = status == 200;
 
         /* Print status messages */
-        mbedtls_printf("HTTPS: Received %d chars from server\r\n", _bpos);
+        uint32_t read_ms = _reader.last_us() / 1000;
+        mbedtls_printf("\r\nHTTPS: Received %lu body bytes in %lu ms, %lu KB/s\r\n",
+                       (unsigned long)_reader.body_bytes(), (unsigned long)read_ms,
+                       (unsigned long)(read_ms ? _reader.body_bytes() / read_ms : 0));
         mbedtls_printf("HTTPS: Received 200 OK status ... %s\r\n", _got200 ? "[OK]" : "[FAIL]");
         mbedtls_printf("HTTPS: Received '%s' status ... %s\r\n", HTTPS_HELLO_STR, _gothello ? "[OK]" : "[FAIL]");
-        mbedtls_printf("HTTPS: Received message:\r\n\r\n");
-        mbedtls_printf("%s", _buffer);
         _error = !(_got200 && _gothello);
 
         _tcpsocket->close();
@@ -299,6 +310,34 @@ public:
     bool error() {
         return _error;
     }
+    /**
+     * Check if the last handshake resumed a cached session
+     * @return Returns true if abbreviated, false if full
+     */
+    bool resumed() {
+        return _resumed;
+    }
+    /**
+     * Time the last handshake took
+     * @return Milliseconds from ClientHello to Finished
+     */
+    uint32_t handshake_ms() {
+        return _handshake_ms;
+    }
+    /**
+     * Time the per-connection TLS setup took
+     * @return Microseconds spent in mbedtls_ssl_setup and friends
+     */
+    uint32_t setup_us() {
+        return _setup_us;
+    }
+    /**
+     * The reader of the last response
+     * @return Reader holding the body size and download time
+     */
+    const HttpsResponseReader &reader() {
+        return _reader;
+    }
     /**
      * Closes the TCP socket
      */
@@ -366,36 +405,23 @@ protected:
 #endif
 
     /**
-     * Receive callback for mbed TLS
+     * Body sink: look for the test string across record boundaries and
+     * echo the start of the body. A download would be written out here.
      */
-    static int ssl_recv(void *ctx, unsigned char *buf, size_t len) {
-        int recv = -1;
-        TCPSocket *socket = static_cast<TCPSocket *>(ctx);
-        recv = socket->recv(buf, len);
-
-        if(NSAPI_ERROR_WOULD_BLOCK == recv){
-            return MBEDTLS_ERR_SSL_WANT_READ;
-        }else if(recv < 0){
-            return -1;
-        }else{
-            return recv;
+    void on_body(const char *data, size_t len) {
+        for (size_t i = 0; i < len && !_gothello; i++) {
+            if (data[i] == HTTPS_HELLO_STR[_hello_match]) {
+                _hello_match++;
+            } else {
+                _hello_match = data[i] == HTTPS_HELLO_STR[0] ? 1 : 0;
+            }
+            _gothello = HTTPS_HELLO_STR[_hello_match] == '\0';
         }
-   }
 
-    /**
-     * Send callback for mbed TLS
-     */
-    static int ssl_send(void *ctx, const unsigned char *buf, size_t len) {
-       int size = -1;
-        TCPSocket *socket = static_cast<TCPSocket *>(ctx);
-        size = socket->send(buf, len);
-
-        if(NSAPI_ERROR_WOULD_BLOCK == size){
-            return len;
-        }else if(size < 0){
-            return -1;
-        }else{
-            return size;
+        if (_echoed < RECV_BUFFER_SIZE) {
+            size_t n = len < RECV_BUFFER_SIZE - _echoed ? len : RECV_BUFFER_SIZE - _echoed;
+            mbedtls_printf("%.*s", (int)n, data);
+            _echoed += n;
         }
     }
 
@@ -410,21 +436,262 @@ protected:
 
     const char *_domain;            /**< The domain name of the HTTPS server */
     const uint16_t _port;           /**< The HTTPS server port */
-    char _buffer[RECV_BUFFER_SIZE]; /**< The response buffer */
-    size_t _bpos;                   /**< The current offset in the response buffer */
+    TlsEnvironment *_tls;           /**< Shared DRBG, CA chain and config */
+    DnsCache *_dns;                 /**< Resolves _domain, or NULL */
+    TlsSessionCache *_sessions;     /**< Sessions to offer and keep, or NULL */
+    bool _resumed;                  /**< The last handshake was abbreviated */
+    uint32_t _handshake_ms;         /**< Duration of the last handshake */
+    uint32_t _setup_us;             /**< Duration of the last connection setup */
+    char _buffer[RECV_BUFFER_SIZE]; /**< The request buffer */
+    size_t _bpos;                   /**< The length of the request */
+    HttpsResponseReader _reader;    /**< Parses the response and streams the body */
+    size_t _echoed;                 /**< Body bytes printed so far */
+    size_t _hello_match;            /**< Characters of the test string matched so far */
     volatile bool _got200;          /**< Status flag for HTTPS 200 */
     volatile bool _gothello;        /**< Status flag for finding the test string */
     volatile bool _error;           /**< Status flag for an error */
     volatile bool _disconnected;
     volatile bool _request_sent;
 
-    mbedtls_entropy_context _entropy;
-    mbedtls_ctr_drbg_context _ctr_drbg;
-    mbedtls_x509_crt _cacert;
     mbedtls_ssl_context _ssl;
-    mbedtls_ssl_config _ssl_conf;
 };
 
+/**
+ * \brief HelloFetch fetches the same file as HelloHTTPS over a
+ * non-blocking TlsConnection, so several run on one reactor thread.
+ */
+class HelloFetch {
+public:
+    HelloFetch(TlsEnvironment *tls, SocketReactor *reactor, TlsSessionCache *sessions, int *running) :
+            _conn(tls, reactor, sessions), _running(running), _got200(false), _gothello(false), _done(false)
+    {
+    }
+
+    int start(NetworkInterface *net, DnsCache *dns) {
+        char request[128];
+        int len = snprintf(request, sizeof(request),
+                           "GET %s HTTP/1.1\r\nHost: %s\r\nConnection: close\r\n\r\n",
+                           HTTPS_PATH, HTTPS_SERVER_NAME);
+
+        int ret = _conn.connect(net, HTTPS_SERVER_NAME, HTTPS_SERVER_PORT,
+                                callback(this, &HelloFetch::on_event), dns);
+        if (ret != 0) {
+            return ret;
+        }
+        /* Queued now, sent as soon as the handshake is done */
+        _conn.write(request, len);
+        (*_running)++;
+        return 0;
+    }
+
+    bool ok() const { return _got200 && _gothello; }
+    TlsConnection &connection() { return _conn; }
+
+private:
+    void on_event(TlsConnection::Event event) {
+        if (event == TlsConnection::EVENT_ERROR) {
+            mbedtls_printf("non-blocking: error -0x%04x\r\n", -_conn.last_error());
+            finish();
+        } else if (event == TlsConnection::EVENT_READABLE) {
+            char buf[RECV_BUFFER_SIZE];
+            nsapi_size_or_error_t n;
+
+            while ((n = _conn.read(buf, sizeof(buf) - 1)) > 0) {
+                buf[n] = 0;
+                _got200 = _got200 || strstr(buf, HTTPS_OK_STR) != NULL;
+                _gothello = _gothello || strstr(buf, HTTPS_HELLO_STR) != NULL;
+            }
+            if (n != NSAPI_ERROR_WOULD_BLOCK || ok()) {
+                finish();
+            }
+        }
+    }
+
+    void finish() {
+        if (_done) {
+            return;
+        }
+        _done = true;
+        _conn.close();
+        (*_running)--;
+    }
+
+    TlsConnection _conn;
+    int *_running;
+    bool _got200;
+    bool _gothello;
+    bool _done;
+};
+
+/**
+ * Fetch the test file HTTPS_PARALLEL times at once from this thread
+ */
+static void fetch_parallel(NetworkInterface *net, TlsEnvironment *tls, DnsCache *dns, TlsSessionCache *sessions)
+{
+    EventQueue queue(16 * EVENTS_EVENT_SIZE);
+    SocketReactor reactor(&queue);
+    HelloFetch *fetches[HTTPS_PARALLEL];
+    int running = 0;
+
+    mbedtls_printf("\r\nNon-blocking: %d fetches from one thread\r\n", HTTPS_PARALLEL);
+    for (int i = 0; i < HTTPS_PARALLEL; i++) {
+        fetches[i] = new HelloFetch(tls, &reactor, sessions, &running);
+        int ret = fetches[i]->start(net, dns);
+        if (ret != 0) {
+            mbedtls_printf("non-blocking: connect %d failed: %d\r\n", i, ret);
+        }
+    }
+
+    Timer timer;
+    timer.start();
+    while (running > 0 && timer.read_ms() < HTTPS_PARALLEL_TIMEOUT_MS) {
+        queue.dispatch(100);
+    }
+
+    for (int i = 0; i < HTTPS_PARALLEL; i++) {
+        TlsConnection &c = fetches[i]->connection();
+        const TlsConnection::Stats &st = c.stats();
+        mbedtls_printf("fetch %d: %s, handshake %lu ms (%s), %lu/%lu bytes in %lu/%lu records, "
+                       "wire %lu/%lu, %lu partial writes, %lu want_read, %lu want_write\r\n",
+                       i, fetches[i]->ok() ? "OK" : "FAIL", (unsigned long)c.handshake_ms(),
+                       c.resumed() ? "resumed" : "full",
+                       (unsigned long)st.bytes_sent, (unsigned long)st.bytes_received,
+                       (unsigned long)st.records_sent, (unsigned long)st.records_received,
+                       (unsigned long)st.wire_sent, (unsigned long)st.wire_received,
+                       (unsigned long)st.partial_writes, (unsigned long)st.want_read,
+                       (unsigned long)st.want_write);
+        delete fetches[i];
+    }
+}
+
+#if defined(MBED_CONF_APP_HTTPS_BENCH_HOST)
+/* Requests per mode of the HTTPS benchmark */
+const int HTTPS_BENCH_REQUESTS = 20;
+
+struct BodyCounter {
+    BodyCounter() : bytes(0) {}
+    void on_body(const char *data, size_t len) { bytes += len; }
+    uint32_t bytes;
+};
+
+static void https_bench_print(const char *mode, int ok, uint32_t bytes, int ms, uint32_t connects,
+                              uint32_t resumed)
+{
+    if (ms <= 0) {
+        ms = 1;
+    }
+    mbedtls_printf("%-10s %3d req %6lu req/s x100 %6lu KB/s %3lu handshake(s), %lu resumed\r\n", mode, ok,
+                   (unsigned long)(ok * 100000UL / ms), (unsigned long)((uint64_t)bytes * 1000 / ms / 1024),
+                   (unsigned long)connects, (unsigned long)resumed);
+}
+
+/**
+ * Compare a handshake per request with keep-alive and pipelining against a
+ * local server. It has a throwaway certificate, so the bench has its own
+ * environment that checks none. A server that keeps connections alive:
+ *     openssl req -x509 -newkey rsa:2048 -nodes -keyout key.pem -out cert.pem -subj /CN=bench
+ *     python3 -c "import http.server as h, ssl; h.SimpleHTTPRequestHandler.protocol_version = 'HTTP/1.1'; \
+ *         s = h.HTTPServer(('', 4443), h.SimpleHTTPRequestHandler); \
+ *         c = ssl.SSLContext(ssl.PROTOCOL_TLS_SERVER); c.load_cert_chain('cert.pem', 'key.pem'); \
+ *         s.socket = c.wrap_socket(s.socket, server_side=True); s.serve_forever()"
+ */
+static void https_bench(NetworkInterface *net, DnsCache *dns)
+{
+    const char *host = MBED_CONF_APP_HTTPS_BENCH_HOST;
+    const char *path = MBED_CONF_APP_HTTPS_BENCH_PATH;
+    const uint16_t port = MBED_CONF_APP_HTTPS_BENCH_PORT;
+    const char *paths[HTTPS_CLIENT_MAX_PIPELINE];
+    TlsSessionCache sessions;
+    Timer timer;
+    int ok;
+
+    for (int i = 0; i < HTTPS_CLIENT_MAX_PIPELINE; i++) {
+        paths[i] = path;
+    }
+
+    /* Clients hold a receive buffer each, keep them off the stack */
+    TlsEnvironment *tls = new TlsEnvironment();
+    int ret = tls->init(NULL, 0, DRBG_PERS);
+    if (ret != 0) {
+        mbedtls_printf("HTTPS benchmark: TLS environment init failed: -0x%04x\r\n", -ret);
+        delete tls;
+        return;
+    }
+    mbedtls_ssl_conf_authmode(tls->config(), MBEDTLS_SSL_VERIFY_NONE);
+    TlsSessionCache::enable_tickets(tls->config());
+
+    mbedtls_printf("\r\nHTTPS benchmark: %d x GET https://%s:%d%s\r\n", HTTPS_BENCH_REQUESTS,
+                   host, port, path);
+
+    /* A full handshake per request */
+    BodyCounter oneshot;
+    ok = 0;
+    timer.start();
+    for (int i = 0; i < HTTPS_BENCH_REQUESTS; i++) {
+        HttpsClient *client = new HttpsClient(net, tls, host, port, dns);
+        if (client->get(path, callback(&oneshot, &BodyCounter::on_body)) > 0) {
+            ok++;
+        }
+        delete client;
+    }
+    timer.stop();
+    https_bench_print("one-shot", ok, oneshot.bytes, timer.read_ms(), HTTPS_BENCH_REQUESTS, 0);
+
+    /* A connection per request, resuming the first one's session */
+    BodyCounter resumed;
+    uint32_t resumed_handshakes = 0;
+    ok = 0;
+    timer.reset();
+    timer.start();
+    for (int i = 0; i < HTTPS_BENCH_REQUESTS; i++) {
+        HttpsClient *client = new HttpsClient(net, tls, host, port, dns, &sessions);
+        if (client->get(path, callback(&resumed, &BodyCounter::on_body)) > 0) {
+            ok++;
+        }
+        resumed_handshakes += client->resumed();
+        delete client;
+    }
+    timer.stop();
+    https_bench_print("resumed", ok, resumed.bytes, timer.read_ms(), HTTPS_BENCH_REQUESTS, resumed_handshakes);
+
+    /* One persistent connection, one request at a time */
+    BodyCounter keepalive;
+    HttpsClient *client = new HttpsClient(net, tls, host, port, dns, &sessions);
+    ok = 0;
+    timer.reset();
+    timer.start();
+    for (int i = 0; i < HTTPS_BENCH_REQUESTS; i++) {
+        if (client->get(path, callback(&keepalive, &BodyCounter::on_body)) > 0) {
+            ok++;
+        }
+    }
+    timer.stop();
+    https_bench_print("keep-alive", ok, keepalive.bytes, timer.read_ms(), client->connects(), client->resumed());
+    delete client;
+
+    /* One persistent connection, HTTPS_CLIENT_MAX_PIPELINE requests in flight */
+    BodyCounter pipelined;
+    HttpsClient *pipe = new HttpsClient(net, tls, host, port, dns, &sessions);
+    ok = 0;
+    timer.reset();
+    timer.start();
+    for (int left = HTTPS_BENCH_REQUESTS; left > 0; ) {
+        int n = left < HTTPS_CLIENT_MAX_PIPELINE ? left : HTTPS_CLIENT_MAX_PIPELINE;
+        int got = pipe->get_pipelined(paths, n, callback(&pipelined, &BodyCounter::on_body));
+        if (got <= 0) {
+            break;
+        }
+        ok += got;
+        left -= got;
+    }
+    timer.stop();
+    https_bench_print("pipelined", ok, pipelined.bytes, timer.read_ms(), pipe->connects(), pipe->resumed());
+    pipe->reader().print_stats("HTTPS pipelined download");
+    delete pipe;
+    delete tls;
+}
+#endif
+
 /**
  * The main loop of the HTTPS Hello World test
  */
@@ -449,9 +716,79 @@ int app_mbed_tls_client() {
         mbedtls_printf("No Client IP Address\r\n");
     }
 
-    HelloHTTPS *hello = new HelloHTTPS(HTTPS_SERVER_NAME, HTTPS_SERVER_PORT, &wifi_iface);
-    hello->startTest(HTTPS_PATH);
-    delete hello;
+    /* Seed the DRBG and parse the CA chain once for all connections */
+    TlsEnvironment *tls = new TlsEnvironment();
+#if defined(MBED_HEAP_STATS_ENABLED)
+    mbed_stats_heap_t heap_before, heap_after;
+    mbed_stats_heap_get(&heap_before);
+#endif
+    ret = tls->init(SSL_CA_PEM, sizeof(SSL_CA_PEM), DRBG_PERS);
+    if (ret != 0) {
+        char err[128];
+        mbedtls_strerror(ret, err, sizeof(err));
+        mbedtls_printf("TLS environment init failed: -0x%04x: %s\r\n", -ret, err);
+        delete tls;
+        return -1;
+    }
+#if defined(MBED_HEAP_STATS_ENABLED)
+    mbed_stats_heap_get(&heap_after);
+    mbedtls_printf("TLS environment: %lu bytes of heap (CA chain, DRBG)\r\n",
+                   (unsigned long)(heap_after.current_size - heap_before.current_size));
+#endif
+
+    DnsCache dns(&wifi_iface);
+    EventQueue dns_queue(4 * EVENTS_EVENT_SIZE);
+    Thread dns_thread(osPriorityBelowNormal, DNS_PREFETCH_STACK);
+    dns_thread.start(callback(&dns_queue, &EventQueue::dispatch_forever));
+    dns.start_prefetch(&dns_queue);
+    TlsSessionCache sessions;
+    TlsSessionCache::enable_tickets(tls->config());
+    uint32_t full_ms = 0, resumed_ms = 0, setup_us = 0;
+    uint32_t body_bytes = 0, read_us = 0;
+    int full = 0, resumed = 0;
+
+    for (int i = 0; i < HTTPS_RUNS; i++) {
+        HelloHTTPS *hello = new HelloHTTPS(HTTPS_SERVER_NAME, HTTPS_SERVER_PORT, &wifi_iface, tls, &dns, &sessions);
+        hello->startTest(HTTPS_PATH);
+        setup_us += hello->setup_us();
+        body_bytes += hello->reader().stats().body_bytes;
+        read_us += hello->reader().stats().read_us;
+        if (!hello->error()) {
+            if (hello->resumed()) {
+                resumed++;
+                resumed_ms += hello->handshake_ms();
+            } else {
+                full++;
+                full_ms += hello->handshake_ms();
+            }
+        }
+        delete hello;
+    }
+
+    mbedtls_printf("\r\nHandshakes: %d full, avg %lu ms; %d resumed, avg %lu ms\r\n",
+                   full, (unsigned long)(full ? full_ms / full : 0),
+                   resumed, (unsigned long)(resumed ? resumed_ms / resumed : 0));
+    /* Not measured: before the shared environment every connection also paid the one init */
+    mbedtls_printf("TLS setup per connection: avg %lu us, estimated %lu us without sharing (setup + init)\r\n",
+                   (unsigned long)(setup_us / HTTPS_RUNS),
+                   (unsigned long)(setup_us / HTTPS_RUNS + tls->stats().init_us));
+
+    mbedtls_printf("Download: %lu body bytes in %lu ms, %lu KB/s\r\n", (unsigned long)body_bytes,
+                   (unsigned long)(read_us / 1000),
+                   (unsigned long)(read_us >= 1000 ? body_bytes / (read_us / 1000) : 0));
+
+    fetch_parallel(&wifi_iface, tls, &dns, &sessions);
+#if defined(MBED_CONF_APP_HTTPS_BENCH_HOST)
+    https_bench(&wifi_iface, &dns);
+#endif
+
+    tls->print_stats("TLS environment");
+    sessions.print_stats("TLS sessions");
+    dns.stop_prefetch();
+    dns_queue.break_dispatch();
+    dns_thread.join();
+    dns.print_stats("DNS cache");
+    delete tls;
     return 0;
 }
 
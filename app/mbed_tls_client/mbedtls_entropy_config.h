@@ -35,4 +35,130 @@
  */
 #define MBEDTLS_MPI_MAX_SIZE        256
 
-#define MBEDTLS_MPI_WINDOW_SIZE     1
+/*
+ *  Public key crypto profile, chosen with tls-crypto-profile in mbed_app.json.
+ *
+ *  LEAN: smallest bignum window, least RAM and slowest exponentiation.
+ *  SPEED_ECC: ECDHE-ECDSA on P-256 only. Wide bignum and ECP windows,
+ *      fixed-point precomputation for the generator and the NIST P-256
+ *      reduction. Costs a few KB more heap and stack during the handshake.
+ *      RSA certificates still verify, but servers must offer an
+ *      ECDHE-ECDSA suite, so developer.mbed.org (RSA key) is out of reach.
+ *      The fixed-point table belongs to the ecp_group and TLS loads a new
+ *      group per handshake, so ECDH there pays the precomputation.
+ */
+#define TLS_CRYPTO_PROFILE_LEAN         0
+#define TLS_CRYPTO_PROFILE_SPEED_ECC    1
+
+#if defined(MBED_CONF_APP_TLS_CRYPTO_PROFILE)
+#define TLS_CRYPTO_PROFILE              MBED_CONF_APP_TLS_CRYPTO_PROFILE
+#else
+#define TLS_CRYPTO_PROFILE              TLS_CRYPTO_PROFILE_LEAN
+#endif
+
+#if TLS_CRYPTO_PROFILE == TLS_CRYPTO_PROFILE_SPEED_ECC
+#define MBEDTLS_MPI_WINDOW_SIZE         6
+#define MBEDTLS_ECP_WINDOW_SIZE         6
+#define MBEDTLS_ECP_FIXED_POINT_OPTIM   1
+#define MBEDTLS_ECP_NIST_OPTIM
+
+#undef MBEDTLS_ECP_DP_SECP192R1_ENABLED
+#undef MBEDTLS_ECP_DP_SECP224R1_ENABLED
+#undef MBEDTLS_ECP_DP_SECP384R1_ENABLED
+#undef MBEDTLS_ECP_DP_SECP521R1_ENABLED
+#undef MBEDTLS_ECP_DP_SECP192K1_ENABLED
+#undef MBEDTLS_ECP_DP_SECP224K1_ENABLED
+#undef MBEDTLS_ECP_DP_SECP256K1_ENABLED
+#undef MBEDTLS_ECP_DP_BP256R1_ENABLED
+#undef MBEDTLS_ECP_DP_BP384R1_ENABLED
+#undef MBEDTLS_ECP_DP_BP512R1_ENABLED
+#undef MBEDTLS_ECP_DP_CURVE25519_ENABLED
+
+#undef MBEDTLS_KEY_EXCHANGE_PSK_ENABLED
+#undef MBEDTLS_KEY_EXCHANGE_DHE_PSK_ENABLED
+#undef MBEDTLS_KEY_EXCHANGE_ECDHE_PSK_ENABLED
+#undef MBEDTLS_KEY_EXCHANGE_RSA_PSK_ENABLED
+#undef MBEDTLS_KEY_EXCHANGE_RSA_ENABLED
+#undef MBEDTLS_KEY_EXCHANGE_DHE_RSA_ENABLED
+#undef MBEDTLS_KEY_EXCHANGE_ECDHE_RSA_ENABLED
+#undef MBEDTLS_KEY_EXCHANGE_ECDH_ECDSA_ENABLED
+#undef MBEDTLS_KEY_EXCHANGE_ECDH_RSA_ENABLED
+#define TLS_CRYPTO_PROFILE_NAME         "speed ECC (ECDHE-ECDSA P-256)"
+#else
+#define MBEDTLS_MPI_WINDOW_SIZE         1
+#define TLS_CRYPTO_PROFILE_NAME         "lean"
+#endif
+
+/*
+ *  TLS record buffer profile, chosen with tls-memory-profile in mbed_app.json.
+ *
+ *  Each connection allocates an input and an output buffer of the maximum
+ *  content length plus about 500 bytes of headers and MAC, so the default
+ *  16384 costs over 32 KB per connection.
+ *
+ *  MFL_xxx: both buffers shrink and the client asks the server for
+ *      max_fragment_length (RFC 6066). Only for servers that honour the
+ *      extension, others send 16 KB records that can not be received.
+ *      This mbed TLS can not reassemble a handshake message split across
+ *      records either, so the handshake fails against any server whose
+ *      Certificate message is larger than the buffer: a typical chain of
+ *      two RSA certificates is 2.5 to 4 KB, too much for 512, 1024 and
+ *      often 2048.
+ *  ASYMMETRIC: full input buffer, which works with any server, and a 1 KB
+ *      output buffer; needs mbed TLS 2.13 or later.
+ *  VARIABLE: buffers are shrunk to what is used after the handshake; needs
+ *      mbed TLS 2.22 or later.
+ *  Older versions ignore the options of the last two and would build FULL
+ *  under another name, so they stop the build instead.
+ */
+#define TLS_MEMORY_PROFILE_FULL         0
+#define TLS_MEMORY_PROFILE_MFL_4096     1
+#define TLS_MEMORY_PROFILE_MFL_2048     2
+#define TLS_MEMORY_PROFILE_MFL_1024     3
+#define TLS_MEMORY_PROFILE_MFL_512      4
+#define TLS_MEMORY_PROFILE_ASYMMETRIC   5
+#define TLS_MEMORY_PROFILE_VARIABLE     6
+
+#if defined(MBED_CONF_APP_TLS_MEMORY_PROFILE)
+#define TLS_MEMORY_PROFILE              MBED_CONF_APP_TLS_MEMORY_PROFILE
+#else
+#define TLS_MEMORY_PROFILE              TLS_MEMORY_PROFILE_FULL
+#endif
+
+#if TLS_MEMORY_PROFILE == TLS_MEMORY_PROFILE_MFL_4096
+#define MBEDTLS_SSL_MAX_CONTENT_LEN     4096
+#define TLS_MEMORY_MAX_FRAG_LEN         MBEDTLS_SSL_MAX_FRAG_LEN_4096
+#define TLS_MEMORY_PROFILE_NAME         "MFL 4096"
+#elif TLS_MEMORY_PROFILE == TLS_MEMORY_PROFILE_MFL_2048
+#define MBEDTLS_SSL_MAX_CONTENT_LEN     2048
+#define TLS_MEMORY_MAX_FRAG_LEN         MBEDTLS_SSL_MAX_FRAG_LEN_2048
+#define TLS_MEMORY_PROFILE_NAME         "MFL 2048"
+#elif TLS_MEMORY_PROFILE == TLS_MEMORY_PROFILE_MFL_1024
+#define MBEDTLS_SSL_MAX_CONTENT_LEN     1024
+#define TLS_MEMORY_MAX_FRAG_LEN         MBEDTLS_SSL_MAX_FRAG_LEN_1024
+#define TLS_MEMORY_PROFILE_NAME         "MFL 1024"
+#elif TLS_MEMORY_PROFILE == TLS_MEMORY_PROFILE_MFL_512
+#define MBEDTLS_SSL_MAX_CONTENT_LEN     512
+#define TLS_MEMORY_MAX_FRAG_LEN         MBEDTLS_SSL_MAX_FRAG_LEN_512
+#define TLS_MEMORY_PROFILE_NAME         "MFL 512"
+#elif TLS_MEMORY_PROFILE == TLS_MEMORY_PROFILE_ASYMMETRIC
+#include "mbedtls/version.h"
+#if MBEDTLS_VERSION_NUMBER < 0x020D0000
+#error "tls-memory-profile 5 (asymmetric) needs mbed TLS 2.13 or later"
+#endif
+#define MBEDTLS_SSL_IN_CONTENT_LEN      16384
+#define MBEDTLS_SSL_OUT_CONTENT_LEN     1024
+#define TLS_MEMORY_PROFILE_NAME         "asymmetric 16384/1024"
+#elif TLS_MEMORY_PROFILE == TLS_MEMORY_PROFILE_VARIABLE
+#include "mbedtls/version.h"
+#if MBEDTLS_VERSION_NUMBER < 0x02160000
+#error "tls-memory-profile 6 (variable) needs mbed TLS 2.22 or later"
+#endif
+#define MBEDTLS_SSL_VARIABLE_BUFFER_LENGTH
+#define TLS_MEMORY_PROFILE_NAME         "variable"
+#else
+#define TLS_MEMORY_PROFILE_NAME         "full 16384"
+#endif
+
+/* Lets applications count what mbed TLS allocates */
+#define MBEDTLS_PLATFORM_MEMORY
@@ -16,10 +16,14 @@
 
 #include "mbed.h"
 #include "TCPSocket.h"
+#include "HttpClient.h"
+#include "DnsCache.h"
+#include "WiFiScanner.h"
 
 #include "EMW10xxInterface.h"
 
 EMW10xxInterface wifi;
+DnsCache dns_cache(&wifi);
 
 const char *sec2str(nsapi_security_t sec)
 {
@@ -40,63 +44,152 @@ const char *sec2str(nsapi_security_t sec)
     }
 }
 
-void scan_demo(WiFiInterface *wifi)
+static void print_ap(const WiFiAccessPoint &ap)
 {
-    WiFiAccessPoint *ap;
+    printf("Network: %s secured: %s BSSID: %hhX:%hhX:%hhX:%hhx:%hhx:%hhx RSSI: %hhd Ch: %hhd\r\n", ap.get_ssid(),
+           sec2str(ap.get_security()), ap.get_bssid()[0], ap.get_bssid()[1], ap.get_bssid()[2],
+           ap.get_bssid()[3], ap.get_bssid()[4], ap.get_bssid()[5], ap.get_rssi(), ap.get_channel());
+}
 
+void scan_demo(WiFiScanner *scanner)
+{
     printf("Scan:\r\n");
 
-    int count = wifi->scan(NULL,0);
+    // One scan, each network is printed as it is reported
+    int count = scanner->scan(callback(print_ap));
+    if (count < 0) {
+        printf("Scan failed %d\r\n", count);
+        return;
+    }
+    printf("%d networks kept, strongest: %s\r\n", count, count ? scanner->get(0)->get_ssid() : "-");
+}
 
-    /* Limit number of network arbitrary to 15 */
-    count = count < 15 ? count : 15;
+namespace {
 
-    ap = new WiFiAccessPoint[count];
-    count = wifi->scan(ap, count);
-    for (int i = 0; i < count; i++)
-    {
-        printf("Network: %s secured: %s BSSID: %hhX:%hhX:%hhX:%hhx:%hhx:%hhx RSSI: %hhd Ch: %hhd\r\n", ap[i].get_ssid(),
-               sec2str(ap[i].get_security()), ap[i].get_bssid()[0], ap[i].get_bssid()[1], ap[i].get_bssid()[2],
-               ap[i].get_bssid()[3], ap[i].get_bssid()[4], ap[i].get_bssid()[5], ap[i].get_rssi(), ap[i].get_channel());
-    }
-    printf("%d networks available.\r\n", count);
+/* Adds up body bytes, the body itself is dropped */
+struct BodyCounter {
+    BodyCounter() : bytes(0) {}
+    void on_body(const char *data, size_t len) { bytes += len; }
+    uint32_t bytes;
+};
 
-    delete[] ap;
 }
 
 void http_demo(NetworkInterface *net)
 {
-    TCPSocket socket;
+    HttpClient client(net, "www.arm.com", 80, &dns_cache);
+    BodyCounter body;
 
     printf("Sending HTTP request to www.arm.com...\r\n");
 
-    // Open a socket on the network interface, and create a TCP connection to www.arm.com
-    socket.open(net);
-    socket.connect("www.arm.com", 80);
+    // GET / and stream the body through the counter, whatever its size or encoding
+    int status = client.get("/", callback(&body, &BodyCounter::on_body));
+    printf("status %d, %lu body bytes\r\n", status, (unsigned long)body.bytes);
+
+    // The connection stays open, a second request does not reconnect
+    status = client.get("/", callback(&body, &BodyCounter::on_body));
+    printf("status %d, %lu body bytes total over %lu connection(s)\r\n", status,
+           (unsigned long)body.bytes, (unsigned long)client.connects());
+
+    // A new connection to the same host is resolved from the cache
+    client.close();
+    status = client.get("/", callback(&body, &BodyCounter::on_body));
+    printf("status %d after reconnecting\r\n", status);
+    dns_cache.print_stats("DNS cache");
+}
+
+#if defined(MBED_CONF_APP_HTTP_BENCH_HOST)
+#define HTTP_BENCH_REQUESTS     50
 
-    // Send a simple http request
-    char sbuffer[] = "GET / HTTP/1.1\r\nHost: www.arm.com\r\n\r\n";
-    int scount = socket.send(sbuffer, sizeof sbuffer);
-    printf("sent %d [%.*s]\r\n", scount, strstr(sbuffer, "\r\n")-sbuffer, sbuffer);
+static void http_bench_print(const char *mode, int ok, uint32_t bytes, int ms, uint32_t connects)
+{
+    if (ms <= 0) {
+        ms = 1;
+    }
+    unsigned long req_x100 = ok * 100000UL / ms;
+    unsigned long mb_x1000 = (unsigned long)((uint64_t)bytes * 1000 * 1000 / ms / (1024 * 1024));
+    printf("%-10s %3d req %4lu.%02lu req/s %3lu.%03lu MB/s %3lu connection(s)\r\n", mode, ok,
+           req_x100 / 100, req_x100 % 100, mb_x1000 / 1000, mb_x1000 % 1000,
+           (unsigned long)connects);
+}
 
-    // Recieve a simple http response and print out the response line
-    char rbuffer[64];
-    int rcount = socket.recv(rbuffer, sizeof rbuffer);
-    printf("recv %d [%.*s]\r\n", rcount, strstr(rbuffer, "\r\n")-rbuffer, rbuffer);
+// Compare a connection per request with keep-alive and pipelining against a local server
+void http_bench(NetworkInterface *net)
+{
+    const char *host = MBED_CONF_APP_HTTP_BENCH_HOST;
+    const char *path = MBED_CONF_APP_HTTP_BENCH_PATH;
+    const char *paths[HTTP_CLIENT_MAX_PIPELINE];
+    Timer timer;
+    int ok;
+
+    for (int i = 0; i < HTTP_CLIENT_MAX_PIPELINE; i++) {
+        paths[i] = path;
+    }
 
-    // Close the socket to return its memory and bring down the network interface
-    socket.close();
+    printf("\r\nHTTP benchmark: %d x GET http://%s:%d%s\r\n", HTTP_BENCH_REQUESTS,
+           host, MBED_CONF_APP_HTTP_BENCH_PORT, path);
+
+    // One connection per request
+    BodyCounter oneshot;
+    ok = 0;
+    timer.reset();
+    timer.start();
+    for (int i = 0; i < HTTP_BENCH_REQUESTS; i++) {
+        HttpClient client(net, host, MBED_CONF_APP_HTTP_BENCH_PORT, &dns_cache);
+        if (client.get(path, callback(&oneshot, &BodyCounter::on_body)) > 0) {
+            ok++;
+        }
+    }
+    timer.stop();
+    http_bench_print("one-shot", ok, oneshot.bytes, timer.read_ms(), HTTP_BENCH_REQUESTS);
+
+    // One persistent connection, one request at a time
+    BodyCounter keepalive;
+    HttpClient client(net, host, MBED_CONF_APP_HTTP_BENCH_PORT, &dns_cache);
+    ok = 0;
+    timer.reset();
+    timer.start();
+    for (int i = 0; i < HTTP_BENCH_REQUESTS; i++) {
+        if (client.get(path, callback(&keepalive, &BodyCounter::on_body)) > 0) {
+            ok++;
+        }
+    }
+    timer.stop();
+    http_bench_print("keep-alive", ok, keepalive.bytes, timer.read_ms(), client.connects());
+
+    // One persistent connection, HTTP_CLIENT_MAX_PIPELINE requests in flight
+    BodyCounter pipelined;
+    HttpClient pipe(net, host, MBED_CONF_APP_HTTP_BENCH_PORT, &dns_cache);
+    ok = 0;
+    timer.reset();
+    timer.start();
+    for (int left = HTTP_BENCH_REQUESTS; left > 0; ) {
+        int n = left < HTTP_CLIENT_MAX_PIPELINE ? left : HTTP_CLIENT_MAX_PIPELINE;
+        int ret = pipe.get_pipelined(paths, n, callback(&pipelined, &BodyCounter::on_body));
+        if (ret <= 0) {
+            break;
+        }
+        ok += ret;
+        left -= ret;
+    }
+    timer.stop();
+    http_bench_print("pipelined", ok, pipelined.bytes, timer.read_ms(), pipe.connects());
 }
+#endif
 
 int app_mbed_wifi()
 {
+    /* Built on the first call, after MiCO is up; kept off the stack */
+    static WiFiScanner scanner;
+
     printf("WiFi example\r\n\r\n");
 
-    scan_demo(&wifi);
+    scan_demo(&scanner);
 
     printf("\r\nConnecting...\r\n");
 
-    int ret = wifi.connect( MBED_CONF_APP_WIFI_SSID, MBED_CONF_APP_WIFI_PASSWORD, NSAPI_SECURITY_WPA_WPA2, 0 );
+    // The channel comes from the scan, the driver does not scan again
+    int ret = scanner.connect( &wifi, MBED_CONF_APP_WIFI_SSID, MBED_CONF_APP_WIFI_PASSWORD, NSAPI_SECURITY_WPA_WPA2 );
     if (ret != 0) {
         printf("\r\nConnection error\r\n");
         return -1;
@@ -110,6 +203,9 @@ int app_mbed_wifi()
     printf("RSSI: %d\r\n\r\n", wifi.get_rssi());
 
     http_demo(&wifi);
+#if defined(MBED_CONF_APP_HTTP_BENCH_HOST)
+    http_bench(&wifi);
+#endif
 
     wifi.disconnect();
 
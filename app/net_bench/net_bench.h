@@ -0,0 +1,72 @@
+/* MiCO Team
+ * Copyright (c) 2017 MXCHIP Information Tech. Co.,Ltd
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/******************************************************
+ *                    Constants
+ ******************************************************/
+
+/* Host peer ports, see net_bench_main.cpp */
+#define NET_BENCH_TCP_SINK_PORT     (9000)
+#define NET_BENCH_TCP_SOURCE_PORT   (9001)
+#define NET_BENCH_UDP_ECHO_PORT     (9002)
+
+#define NET_BENCH_MAX_PAYLOAD       (8192)
+/* UDP payload of one 1500 byte frame, larger echoes would be IP fragments */
+#define NET_BENCH_UDP_MAX_PAYLOAD   (1472)
+#define NET_BENCH_RX_TIMEOUT_MS     (500)
+
+/******************************************************
+ *                    Structures
+ ******************************************************/
+
+/*
+ * One socket API under test. The BSD and NSAPI implementations live in
+ * separate files so the lwIP socket macros of mico.h never meet the mbed
+ * socket classes.
+ */
+typedef struct net_bench_ops_s
+{
+    const char *name;
+    /* open a TCP connection or a UDP socket aimed at host:port, 0 on success */
+    int (*connect_to)( int udp, const char *host, uint16_t port );
+    /* send/sendto, bytes sent or negative error */
+    int (*tx)( const void *buf, int len );
+    /* recv/recvfrom with NET_BENCH_RX_TIMEOUT_MS, bytes received or negative error */
+    int (*rx)( void *buf, int len );
+    void (*disconnect)( void );
+} net_bench_ops_t;
+
+/******************************************************
+ *               Variables Declarations
+ ******************************************************/
+
+/* MiCO lwIP BSD sockets, as used by iperf */
+extern const net_bench_ops_t net_bench_bsd_ops;
+
+/* EMW10xxInterface TCPSocket/UDPSocket */
+extern const net_bench_ops_t net_bench_nsapi_ops;
+
+#ifdef __cplusplus
+} /*extern "C" */
+#endif
@@ -0,0 +1,84 @@
+/* MiCO Team
+ * Copyright (c) 2017 MXCHIP Information Tech. Co.,Ltd
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "mico.h"
+
+#include "net_bench.h"
+
+/******************************************************
+ *               Variables Definitions
+ ******************************************************/
+
+static int bsd_fd = -1;
+static int bsd_udp;
+static struct sockaddr_in bsd_peer;
+
+/******************************************************
+ *               Function Definitions
+ ******************************************************/
+
+static int bsd_connect_to( int udp, const char *host, uint16_t port )
+{
+    uint32_t timeout = NET_BENCH_RX_TIMEOUT_MS;
+
+    bsd_fd = socket( AF_INET, udp ? SOCK_DGRAM : SOCK_STREAM, 0 );
+    if ( bsd_fd < 0 ) {
+        return kNoResourcesErr;
+    }
+    setsockopt( bsd_fd, SOL_SOCKET, SO_RCVTIMEO, (char *) &timeout, sizeof(timeout) );
+
+    memset( &bsd_peer, 0, sizeof(bsd_peer) );
+    bsd_peer.sin_family = AF_INET;
+    bsd_peer.sin_addr.s_addr = inet_addr( host );
+    bsd_peer.sin_port = htons( port );
+    bsd_udp = udp;
+
+    if ( !udp && connect( bsd_fd, (struct sockaddr *) &bsd_peer, sizeof(bsd_peer) ) < 0 ) {
+        close( bsd_fd );
+        bsd_fd = -1;
+        return kConnectionErr;
+    }
+    return kNoErr;
+}
+
+static int bsd_tx( const void *buf, int len )
+{
+    if ( bsd_udp ) {
+        return sendto( bsd_fd, buf, len, 0, (struct sockaddr *) &bsd_peer, sizeof(bsd_peer) );
+    }
+    return send( bsd_fd, buf, len, 0 );
+}
+
+static int bsd_rx( void *buf, int len )
+{
+    if ( bsd_udp ) {
+        return recvfrom( bsd_fd, buf, len, 0, NULL, NULL );
+    }
+    return recv( bsd_fd, buf, len, 0 );
+}
+
+static void bsd_disconnect( void )
+{
+    if ( bsd_fd >= 0 ) {
+        close( bsd_fd );
+        bsd_fd = -1;
+    }
+}
+
+const net_bench_ops_t net_bench_bsd_ops =
+{
+    "bsd", bsd_connect_to, bsd_tx, bsd_rx, bsd_disconnect,
+};
@@ -0,0 +1,222 @@
+/* MiCO Team
+ * Copyright (c) 2017 MXCHIP Information Tech. Co.,Ltd
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/** \file net_bench_main.cpp
+ *  \brief Sweep TCP send, TCP recv and UDP sendto/recvfrom over payload
+ *  sizes through the mbed NSAPI sockets and through MiCO BSD sockets, and
+ *  print what the NSAPI layer costs.
+ *
+ *  Host peer, at net-bench-host in mbed_app.json:
+ *      TCP sink:    nc -lk 9000 > /dev/null
+ *      TCP source:  while true; do nc -l 9001 < /dev/zero; done
+ *      UDP echo:    socat UDP-LISTEN:9002,fork PIPE
+ *
+ *  UDP sizes stop at NET_BENCH_UDP_MAX_PAYLOAD so no datagram goes through
+ *  IP fragmentation and reassembly. Each datagram carries a sequence
+ *  number; an echo that arrives after its receive timed out is skipped and
+ *  counted as late instead of being taken as the next reply.
+ */
+
+#include "mbed.h"
+#include "us_ticker_api.h"
+#include "EMW10xxInterface.h"
+
+#include "net_bench.h"
+
+#if defined(MBED_CONF_APP_NET_BENCH_HOST)
+#define NET_BENCH_HOST  MBED_CONF_APP_NET_BENCH_HOST
+#else
+#define NET_BENCH_HOST  NULL
+#endif
+
+/* Time spent on each size, API and test */
+#define NET_BENCH_RUN_MS    2000
+
+extern NetworkInterface *net_bench_interface;
+
+namespace {
+
+enum BenchTest {
+    TEST_TCP_SEND,
+    TEST_TCP_RECV,
+    TEST_UDP_ECHO,
+    TEST_COUNT
+};
+
+const char *const test_names[TEST_COUNT] = {
+    "TCP send", "TCP recv", "UDP sendto/recvfrom"
+};
+
+const int sizes[] = { 64, 128, 256, 512, 1024, 2048, 4096, 8192 };
+const int size_count = sizeof(sizes) / sizeof(sizes[0]);
+
+struct BenchResult {
+    uint32_t bytes;
+    uint32_t calls;
+    uint32_t errors;
+    uint32_t late;       /**< UDP echoes of an earlier, timed out round trip */
+    uint32_t total_us;   /**< Time spent inside the measured calls */
+    uint32_t max_us;
+    uint32_t elapsed_ms;
+};
+
+BenchResult results[TEST_COUNT][2][size_count];
+
+const char *const bench_host = NET_BENCH_HOST;
+
+}
+
+static bool size_runs(BenchTest test, int size)
+{
+    return test != TEST_UDP_ECHO || size <= NET_BENCH_UDP_MAX_PAYLOAD;
+}
+
+static void run_one(const net_bench_ops_t *ops, BenchTest test, int size, uint8_t *buf, BenchResult *r)
+{
+    static const uint16_t ports[TEST_COUNT] = {
+        NET_BENCH_TCP_SINK_PORT, NET_BENCH_TCP_SOURCE_PORT, NET_BENCH_UDP_ECHO_PORT
+    };
+
+    memset(r, 0, sizeof(*r));
+    if (ops->connect_to(test == TEST_UDP_ECHO, bench_host, ports[test]) != 0) {
+        r->errors++;
+        return;
+    }
+
+    uint32_t start = us_ticker_read();
+    while (us_ticker_read() - start < NET_BENCH_RUN_MS * 1000) {
+        uint32_t t0 = us_ticker_read();
+        int n;
+
+        if (test == TEST_TCP_SEND) {
+            n = ops->tx(buf, size);
+        } else if (test == TEST_TCP_RECV) {
+            n = ops->rx(buf, size);
+        } else {
+            /* One call is a whole round trip, the echo comes back in one datagram */
+            uint32_t seq = r->calls;
+            memcpy(buf, &seq, sizeof(seq));
+            n = ops->tx(buf, size);
+            while (n == size) {
+                n = ops->rx(buf, size);
+                if (n < (int)sizeof(seq) || memcmp(buf, &seq, sizeof(seq)) == 0) {
+                    break;
+                }
+                r->late++;
+            }
+        }
+
+        uint32_t dt = us_ticker_read() - t0;
+        r->calls++;
+        r->total_us += dt;
+        if (dt > r->max_us) {
+            r->max_us = dt;
+        }
+        if (n > 0) {
+            r->bytes += n;
+        } else {
+            r->errors++;
+            if (test != TEST_UDP_ECHO) {
+                /* Peer gone, the connection will not recover */
+                break;
+            }
+        }
+    }
+    r->elapsed_ms = (us_ticker_read() - start) / 1000;
+
+    ops->disconnect();
+}
+
+static uint32_t kbytes_per_sec(const BenchResult &r)
+{
+    return r.elapsed_ms ? (uint32_t)((uint64_t)r.bytes * 1000 / r.elapsed_ms / 1024) : 0;
+}
+
+static uint32_t calls_per_sec(const BenchResult &r)
+{
+    return r.elapsed_ms ? (uint32_t)((uint64_t)r.calls * 1000 / r.elapsed_ms) : 0;
+}
+
+static uint32_t avg_us(const BenchResult &r)
+{
+    return r.calls ? r.total_us / r.calls : 0;
+}
+
+static void print_table(BenchTest test)
+{
+    printf("\r\n%s\r\n", test_names[test]);
+    printf("  size |       nsapi: KB/s  calls/s  avg us  max us |         bsd: KB/s  calls/s  avg us  max us | nsapi cost\r\n");
+
+    for (int i = 0; i < size_count; i++) {
+        if (!size_runs(test, sizes[i])) {
+            continue;
+        }
+        const BenchResult &n = results[test][0][i];
+        const BenchResult &b = results[test][1][i];
+        long cost = (long)avg_us(n) - (long)avg_us(b);
+
+        printf("%6d | %18lu %8lu %7lu %7lu | %18lu %8lu %7lu %7lu | %+5ld us/call%s%s\r\n", sizes[i],
+               (unsigned long)kbytes_per_sec(n), (unsigned long)calls_per_sec(n),
+               (unsigned long)avg_us(n), (unsigned long)n.max_us,
+               (unsigned long)kbytes_per_sec(b), (unsigned long)calls_per_sec(b),
+               (unsigned long)avg_us(b), (unsigned long)b.max_us,
+               cost, (n.errors || b.errors) ? " (errors)" : "", (n.late || b.late) ? " (late echoes)" : "");
+    }
+}
+
+int app_net_bench()
+{
+    EMW10xxInterface wifi_iface;
+    const net_bench_ops_t *apis[2] = { &net_bench_nsapi_ops, &net_bench_bsd_ops };
+
+    if (!bench_host) {
+        printf("Set net-bench-host in mbed_app.json to the host peer\r\n");
+        return -1;
+    }
+
+    int ret = wifi_iface.connect(MBED_CONF_APP_WIFI_SSID, MBED_CONF_APP_WIFI_PASSWORD, NSAPI_SECURITY_WPA_WPA2, 0);
+    if (ret != 0) {
+        printf("\r\nConnection error\r\n");
+        return -1;
+    }
+    printf("IP: %s, peer %s\r\n", wifi_iface.get_ip_address(), bench_host);
+    net_bench_interface = &wifi_iface;
+
+    uint8_t *buf = new uint8_t[NET_BENCH_MAX_PAYLOAD];
+    memset(buf, 0x5A, NET_BENCH_MAX_PAYLOAD);
+
+    for (int test = 0; test < TEST_COUNT; test++) {
+        for (int i = 0; i < size_count; i++) {
+            if (!size_runs((BenchTest)test, sizes[i])) {
+                continue;
+            }
+            /* Alternate the APIs per size so drift in the air hits both alike */
+            for (int api = 0; api < 2; api++) {
+                run_one(apis[api], (BenchTest)test, sizes[i], buf, &results[test][api][i]);
+                printf("%s %s %d: %lu KB/s\r\n", apis[api]->name, test_names[test], sizes[i],
+                       (unsigned long)kbytes_per_sec(results[test][api][i]));
+            }
+        }
+    }
+
+    for (int test = 0; test < TEST_COUNT; test++) {
+        print_table((BenchTest)test);
+    }
+
+    delete[] buf;
+    wifi_iface.disconnect();
+    return 0;
+}
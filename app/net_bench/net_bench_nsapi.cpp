@@ -0,0 +1,86 @@
+/* MiCO Team
+ * Copyright (c) 2017 MXCHIP Information Tech. Co.,Ltd
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "mbed.h"
+#include "TCPSocket.h"
+#include "UDPSocket.h"
+
+#include "net_bench.h"
+
+/* Set by app_net_bench before the NSAPI ops are used */
+NetworkInterface *net_bench_interface = NULL;
+
+namespace {
+
+TCPSocket nsapi_tcp;
+UDPSocket nsapi_udp;
+SocketAddress nsapi_peer;
+bool nsapi_is_udp;
+
+int nsapi_connect_to(int udp, const char *host, uint16_t port)
+{
+    nsapi_error_t err;
+
+    nsapi_is_udp = udp;
+    if (udp) {
+        err = nsapi_udp.open(net_bench_interface);
+        nsapi_udp.set_timeout(NET_BENCH_RX_TIMEOUT_MS);
+        nsapi_peer = SocketAddress(host, port);
+        return err;
+    }
+
+    err = nsapi_tcp.open(net_bench_interface);
+    if (err != NSAPI_ERROR_OK) {
+        return err;
+    }
+    nsapi_tcp.set_timeout(NET_BENCH_RX_TIMEOUT_MS);
+    err = nsapi_tcp.connect(host, port);
+    if (err != NSAPI_ERROR_OK) {
+        nsapi_tcp.close();
+    }
+    return err;
+}
+
+int nsapi_tx(const void *buf, int len)
+{
+    if (nsapi_is_udp) {
+        return nsapi_udp.sendto(nsapi_peer, buf, len);
+    }
+    return nsapi_tcp.send(buf, len);
+}
+
+int nsapi_rx(void *buf, int len)
+{
+    if (nsapi_is_udp) {
+        return nsapi_udp.recvfrom(NULL, buf, len);
+    }
+    return nsapi_tcp.recv(buf, len);
+}
+
+void nsapi_disconnect()
+{
+    if (nsapi_is_udp) {
+        nsapi_udp.close();
+    } else {
+        nsapi_tcp.close();
+    }
+}
+
+}
+
+const net_bench_ops_t net_bench_nsapi_ops = {
+    "nsapi", nsapi_connect_to, nsapi_tx, nsapi_rx, nsapi_disconnect,
+};
@@ -0,0 +1,322 @@
+/* Reactor benchmark
+ * Copyright (c) 2017 MXCHIP Information Tech. Co.,Ltd
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/** \file reactor_bench_main.cpp
+ *  \brief Serve BENCH_CONNECTIONS TCP echo connections from one thread with
+ *  SocketReactor, then from one thread per connection, and compare.
+ *
+ *  Host side, for each phase open BENCH_CONNECTIONS connections to the port
+ *  printed on the console and keep them busy, for example:
+ *      for i in $(seq 8); do (cat /dev/zero | nc <ip> 7000 > /dev/null &); done
+ */
+
+#include "mbed.h"
+#include "TCPSocket.h"
+#include "TCPServer.h"
+#include "EMW10xxInterface.h"
+#include "SocketReactor.h"
+
+namespace {
+
+const int BENCH_PORT_REACTOR = 7000;
+const int BENCH_PORT_THREADS = 7001;
+const int BENCH_CONNECTIONS = 8;
+const int BENCH_SECONDS = 30;
+const int BENCH_BUFFER_SIZE = 512;
+const int BENCH_THREAD_STACK = 2048;
+/* recv/send rounds per dispatch before yielding to the other connections */
+const int BENCH_ROUNDS_PER_DISPATCH = 4;
+
+struct BenchResult {
+    uint32_t bytes;
+    uint32_t ms;
+    uint32_t ram;        /**< Static + stack RAM dedicated to serving the connections */
+    uint32_t stack_used; /**< Sum of the peak stack use of the serving threads */
+};
+
+volatile bool bench_stop = false;
+
+}
+
+/**
+ * \brief EchoConnection echoes one TCP connection, either driven by a
+ * SocketReactor or by its own blocking thread.
+ */
+class EchoConnection {
+public:
+    EchoConnection() : _reactor(NULL), _len(0), _off(0), _bytes(0), _closed(false) {}
+
+    TCPSocket *socket() { return &_socket; }
+    uint32_t bytes() const { return _bytes; }
+
+    /** Watch the accepted socket with a reactor */
+    void attach(SocketReactor *reactor) {
+        _reactor = reactor;
+        _reactor->add(&_socket, callback(this, &EchoConnection::pump));
+    }
+
+    /** Stop and close the socket */
+    void close() {
+        if (_reactor) {
+            _reactor->remove(&_socket);
+        }
+        _socket.close();
+    }
+
+    /** Reactor handler: move data until the socket would block */
+    void pump() {
+        for (int round = 0; round < BENCH_ROUNDS_PER_DISPATCH && !_closed; round++) {
+            while (_off < _len) {
+                nsapi_size_or_error_t n = _socket.send(_buf + _off, _len - _off);
+                if (n == NSAPI_ERROR_WOULD_BLOCK) {
+                    return;
+                } else if (n < 0) {
+                    _closed = true;
+                    return;
+                }
+                _off += n;
+            }
+
+            nsapi_size_or_error_t n = _socket.recv(_buf, sizeof(_buf));
+            if (n == NSAPI_ERROR_WOULD_BLOCK) {
+                return;
+            } else if (n <= 0) {
+                _closed = true;
+                return;
+            }
+            _len = n;
+            _off = 0;
+            _bytes += n;
+        }
+
+        /* Still busy, come back after the others had their turn */
+        if (!_closed) {
+            _reactor->notify(&_socket);
+        }
+    }
+
+    /** Thread body: blocking echo until bench_stop */
+    void run_blocking() {
+        _socket.set_timeout(500);
+        while (!bench_stop) {
+            nsapi_size_or_error_t n = _socket.recv(_buf, sizeof(_buf));
+            if (n == NSAPI_ERROR_WOULD_BLOCK) {
+                continue;
+            } else if (n <= 0) {
+                break;
+            }
+            _bytes += n;
+            for (nsapi_size_or_error_t off = 0; off < n && !bench_stop; ) {
+                nsapi_size_or_error_t sent = _socket.send(_buf + off, n - off);
+                if (sent < 0 && sent != NSAPI_ERROR_WOULD_BLOCK) {
+                    return;
+                }
+                off += sent > 0 ? sent : 0;
+            }
+        }
+    }
+
+private:
+    TCPSocket _socket;
+    SocketReactor *_reactor;
+    uint8_t _buf[BENCH_BUFFER_SIZE];
+    nsapi_size_t _len;
+    nsapi_size_t _off;
+    uint32_t _bytes;
+    bool _closed;
+};
+
+/**
+ * \brief ReactorEchoServer accepts and serves every connection from the
+ * thread that dispatches its EventQueue.
+ */
+class ReactorEchoServer {
+public:
+    ReactorEchoServer(EventQueue *queue) : _queue(queue), _reactor(queue), _accepted(0) {}
+
+    nsapi_error_t start(NetworkInterface *net) {
+        _server.open(net);
+        _server.bind(BENCH_PORT_REACTOR);
+        nsapi_error_t err = _server.listen(BENCH_CONNECTIONS);
+        if (err != NSAPI_ERROR_OK) {
+            return err;
+        }
+        return _reactor.add(&_server, callback(this, &ReactorEchoServer::on_accept));
+    }
+
+    uint32_t bytes() const {
+        uint32_t total = 0;
+        for (int i = 0; i < _accepted; i++) {
+            total += _conns[i].bytes();
+        }
+        return total;
+    }
+
+    uint32_t elapsed_ms() { return _timer.read_ms(); }
+
+private:
+    void on_accept() {
+        while (_accepted < BENCH_CONNECTIONS) {
+            EchoConnection *c = &_conns[_accepted];
+            nsapi_error_t err = _server.accept(c->socket());
+            if (err != NSAPI_ERROR_OK) {
+                return;
+            }
+            c->attach(&_reactor);
+            if (_accepted++ == 0) {
+                _timer.start();
+                _queue->call_in(BENCH_SECONDS * 1000, this, &ReactorEchoServer::stop);
+            }
+            printf("reactor: connection %d\r\n", _accepted);
+        }
+    }
+
+    void stop() {
+        _timer.stop();
+        for (int i = 0; i < _accepted; i++) {
+            _conns[i].close();
+        }
+        _reactor.remove(&_server);
+        _server.close();
+        _queue->break_dispatch();
+    }
+
+    EventQueue *_queue;
+    SocketReactor _reactor;
+    TCPServer _server;
+    EchoConnection _conns[BENCH_CONNECTIONS];
+    int _accepted;
+    Timer _timer;
+};
+
+/* The reactor's own thread, sized like one of the per-connection threads */
+struct ReactorThread {
+    EventQueue *queue;
+    Thread *thread;
+    uint32_t stack_used;
+};
+
+static void reactor_thread(ReactorThread *rt)
+{
+    rt->queue->dispatch_forever();
+    /* The stack of a finished thread is gone, read it while running */
+    rt->stack_used = rt->thread->max_stack();
+}
+
+static BenchResult bench_reactor(NetworkInterface *net)
+{
+    const unsigned queue_size = 16 * EVENTS_EVENT_SIZE;
+    EventQueue queue(queue_size);
+    ReactorEchoServer *server = new ReactorEchoServer(&queue);
+    Thread thread(osPriorityNormal, BENCH_THREAD_STACK);
+    ReactorThread rt = { &queue, &thread, 0 };
+    BenchResult result;
+
+    printf("\r\nReactor: waiting for %d connections on port %d\r\n", BENCH_CONNECTIONS, BENCH_PORT_REACTOR);
+    if (server->start(net) != NSAPI_ERROR_OK) {
+        printf("reactor: listen failed\r\n");
+    } else {
+        thread.start(callback(reactor_thread, &rt));
+        thread.join();
+    }
+
+    result.bytes = server->bytes();
+    result.ms = server->elapsed_ms();
+    result.ram = sizeof(ReactorEchoServer) + queue_size + BENCH_THREAD_STACK + sizeof(Thread);
+    result.stack_used = rt.stack_used;
+    delete server;
+    return result;
+}
+
+static BenchResult bench_threads(NetworkInterface *net)
+{
+    TCPServer server;
+    EchoConnection *conns = new EchoConnection[BENCH_CONNECTIONS];
+    Thread *threads[BENCH_CONNECTIONS];
+    Timer timer;
+    BenchResult result;
+    int accepted = 0;
+
+    memset(&result, 0, sizeof(result));
+    bench_stop = false;
+
+    printf("\r\nThreads: waiting for %d connections on port %d\r\n", BENCH_CONNECTIONS, BENCH_PORT_THREADS);
+    server.open(net);
+    server.bind(BENCH_PORT_THREADS);
+    server.listen(BENCH_CONNECTIONS);
+
+    for (; accepted < BENCH_CONNECTIONS; accepted++) {
+        if (server.accept(conns[accepted].socket()) != NSAPI_ERROR_OK) {
+            break;
+        }
+        threads[accepted] = new Thread(osPriorityNormal, BENCH_THREAD_STACK);
+        threads[accepted]->start(callback(&conns[accepted], &EchoConnection::run_blocking));
+        if (accepted == 0) {
+            timer.start();
+        }
+        printf("threads: connection %d\r\n", accepted + 1);
+    }
+
+    Thread::wait(BENCH_SECONDS * 1000);
+
+    /* Before the threads finish, a joined thread has no stack left to read */
+    for (int i = 0; i < accepted; i++) {
+        result.stack_used += threads[i]->max_stack();
+    }
+    bench_stop = true;
+    timer.stop();
+
+    for (int i = 0; i < accepted; i++) {
+        threads[i]->join();
+        result.bytes += conns[i].bytes();
+        conns[i].close();
+        delete threads[i];
+    }
+    server.close();
+
+    result.ms = timer.read_ms();
+    result.ram = sizeof(EchoConnection) * BENCH_CONNECTIONS
+                 + accepted * (BENCH_THREAD_STACK + sizeof(Thread));
+    delete[] conns;
+    return result;
+}
+
+static void print_result(const char *mode, const BenchResult &r)
+{
+    printf("%-8s %6lu KB/s %8lu bytes RAM %8lu bytes stack used\r\n", mode,
+           (unsigned long)(r.ms ? (uint64_t)r.bytes * 1000 / r.ms / 1024 : 0),
+           (unsigned long)r.ram, (unsigned long)r.stack_used);
+}
+
+int app_reactor_bench()
+{
+    EMW10xxInterface wifi_iface;
+
+    int ret = wifi_iface.connect(MBED_CONF_APP_WIFI_SSID, MBED_CONF_APP_WIFI_PASSWORD, NSAPI_SECURITY_WPA_WPA2, 0);
+    if (ret != 0) {
+        printf("\r\nConnection error\r\n");
+        return -1;
+    }
+    printf("IP: %s\r\n", wifi_iface.get_ip_address());
+
+    BenchResult reactor = bench_reactor(&wifi_iface);
+    BenchResult threads = bench_threads(&wifi_iface);
+
+    printf("\r\n%d TCP echo connections, %d seconds each:\r\n", BENCH_CONNECTIONS, BENCH_SECONDS);
+    print_result("reactor", reactor);
+    print_result("threads", threads);
+    return 0;
+}
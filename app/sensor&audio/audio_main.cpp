@@ -1,6 +1,7 @@
 #include "mbed.h"
 #include "mico.h"
 #include "EMW10xxInterface.h"
+#include "WiFiScanner.h"
 
 #define TARGET_AZ3166
 
@@ -234,6 +235,7 @@ int app_audio( )
     int16_t g_axes[3] = { 0 };
 
     EMW10xxInterface wlan_blink;
+    WiFiScanner wlan_scanner;
 
     /*button callback*/
     InterruptIn _interrupt_BUTTON_A( USER_BUTTON_A );
@@ -362,18 +364,13 @@ int app_audio( )
 
         if ( print_log &&first_time )
         {
-            WiFiAccessPoint *ap;
-            int count = wlan_blink.scan( NULL, 0 );
-            /* Limit number of network arbitrary to 15 */
-            count = count < 15 ? count : 15;
-
-            ap = new WiFiAccessPoint[count];
-            count = wlan_blink.scan( ap, count );
+            /* One scan, results kept strongest first in a fixed table */
+            int count = wlan_scanner.scan( );
             for ( int i = 0; i < count; i++ )
-                {
+            {
                 printf( "SSID:%s,RSSI:%hhd\r\n",
-                        ap[i].get_ssid( ),
-                        ap[i].get_rssi( ) );
+                        wlan_scanner.get( i )->get_ssid( ),
+                        wlan_scanner.get( i )->get_rssi( ) );
             }
 
             lsm6dsl.get_x_axes( (int32_t*) x_axes );
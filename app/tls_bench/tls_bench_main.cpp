@@ -0,0 +1,503 @@
+/* TLS benchmark
+ * Copyright (c) 2017 MXCHIP Information Tech. Co.,Ltd
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/** \file tls_bench_main.cpp
+ *  \brief For each of a few forced cipher suites, time the phases of the
+ *  TLS handshake and the bulk send rate against a local TLS server.
+ *
+ *  Server, on a host the device can reach, with an RSA key:
+ *      openssl req -x509 -newkey rsa:2048 -nodes -keyout key.pem -out cert.pem -subj /CN=bench
+ *      openssl s_server -accept 4433 -cert cert.pem -key key.pem -cipher ALL -quiet > /dev/null
+ *  or mbed TLS's programs/ssl/ssl_server2 with the same key and port.
+ *
+ *  On the device set tls-bench-host in mbed_app.json and run tls_bench.
+ *  The same file builds on a Linux host against an mbed TLS build:
+ *      g++ -O2 -I$MBEDTLS/include app/tls_bench/tls_bench_main.cpp \
+ *          $MBEDTLS/library/libmbedtls.a $MBEDTLS/library/libmbedx509.a \
+ *          $MBEDTLS/library/libmbedcrypto.a -o tls_bench
+ *      ./tls_bench 127.0.0.1 4433
+ *  Add -DTLS_BENCH_HOST_MHZ=<cpu MHz> to get cycles per byte on the host.
+ *
+ *  Phases: "hello" is ClientHello up to ServerHelloDone, including the
+ *  server certificate and ServerKeyExchange signature checks; "key
+ *  exchange" is the client's key exchange messages; "finished" is
+ *  ChangeCipherSpec and Finished both ways. Cycles per byte count only the
+ *  time inside mbedtls_ssl_write that was not spent in the socket send.
+ *
+ *  Heap is the peak mbed TLS allocated for one connection, counted through
+ *  its calloc/free hooks; on the device it follows tls-memory-profile.
+ */
+
+#if defined(__MBED__)
+#include "mbed.h"
+#include "us_ticker_api.h"
+#include "TCPSocket.h"
+#include "EMW10xxInterface.h"
+#include "TlsSocketBio.h"
+#else
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <time.h>
+#include <unistd.h>
+#include <netdb.h>
+#include <sys/socket.h>
+#endif
+
+#include "mbedtls/platform.h"
+#include "mbedtls/ssl.h"
+#include "mbedtls/entropy.h"
+#include "mbedtls/ctr_drbg.h"
+#include "mbedtls/error.h"
+
+#if !defined(__MBED__) && !defined(TLS_BENCH_HOST_MHZ)
+#define TLS_BENCH_HOST_MHZ  0
+#endif
+
+namespace {
+
+/* Bulk send time per suite */
+const uint32_t BENCH_BULK_US = 5 * 1000 * 1000;
+
+/* Plaintext handed to each mbedtls_ssl_write, records are cut at the fragment size */
+const size_t BENCH_WRITE_SIZE = 4096;
+
+/* Forced one at a time. There is no ECDHE-RSA suite with CCM, so CCM uses
+ * plain RSA key exchange; use the ECDSA names for an ECDSA server key.
+ * Suites this mbed TLS does not know are reported and skipped. */
+const char *const suites[] = {
+    "TLS-ECDHE-RSA-WITH-AES-128-GCM-SHA256",
+    "TLS-RSA-WITH-AES-128-CCM",
+    "TLS-ECDHE-RSA-WITH-AES-128-CBC-SHA256",
+    "TLS-ECDHE-RSA-WITH-CHACHA20-POLY1305-SHA256",
+};
+const int suite_count = sizeof(suites) / sizeof(suites[0]);
+
+enum Phase {
+    PHASE_HELLO,
+    PHASE_KEY_EXCHANGE,
+    PHASE_FINISHED,
+    PHASE_COUNT
+};
+
+struct BenchResult {
+    int error;
+    uint32_t phase_us[PHASE_COUNT];
+    uint32_t handshake_us;
+    uint32_t bytes;
+    uint32_t bulk_us;
+    uint32_t crypto_us;     /**< Bulk time outside the socket send */
+    uint32_t heap_peak;     /**< Most heap mbed TLS held for the connection */
+    uint32_t frag_len;      /**< Largest record payload sent */
+};
+
+BenchResult results[suite_count];
+
+const char *DRBG_PERS = "tls bench";
+
+mbedtls_entropy_context entropy;
+mbedtls_ctr_drbg_context ctr_drbg;
+unsigned char bulk[BENCH_WRITE_SIZE];
+
+/* Time spent in the transport's send, subtracted from the bulk time */
+uint32_t send_us;
+
+#if defined(MBEDTLS_PLATFORM_MEMORY)
+/* Size header in front of each block, 8 bytes keep the block aligned */
+union HeapHeader {
+    size_t size;
+    uint64_t align;
+};
+
+size_t heap_now;
+size_t heap_peak;
+
+void *bench_calloc(size_t n, size_t size)
+{
+    if (size && n > (size_t) -1 / size - sizeof(HeapHeader)) {
+        return NULL;
+    }
+    HeapHeader *h = (HeapHeader *) calloc(1, sizeof(HeapHeader) + n * size);
+    if (!h) {
+        return NULL;
+    }
+    h->size = n * size;
+    heap_now += h->size;
+    if (heap_now > heap_peak) {
+        heap_peak = heap_now;
+    }
+    return h + 1;
+}
+
+void bench_free(void *p)
+{
+    if (p) {
+        HeapHeader *h = (HeapHeader *) p - 1;
+        heap_now -= h->size;
+        free(h);
+    }
+}
+#endif
+
+}
+
+/*
+ * Platform part: clock, CPU frequency and a blocking TCP transport
+ */
+
+#if defined(__MBED__)
+
+static NetworkInterface *bench_net;
+static TCPSocket *bench_socket;
+
+static uint32_t bench_now_us()
+{
+    return us_ticker_read();
+}
+
+static uint32_t bench_cpu_mhz()
+{
+    return SystemCoreClock / 1000000;
+}
+
+static int transport_connect(const char *host, uint16_t port)
+{
+    bench_socket = new TCPSocket(bench_net);
+    nsapi_error_t err = bench_socket->connect(host, port);
+    if (err != NSAPI_ERROR_OK) {
+        delete bench_socket;
+        bench_socket = NULL;
+    }
+    return err;
+}
+
+static int transport_send(void *ctx, const unsigned char *buf, size_t len)
+{
+    uint32_t t0 = bench_now_us();
+    int n = TlsSocketBio::send(bench_socket, buf, len);
+    send_us += bench_now_us() - t0;
+    return n;
+}
+
+static int transport_recv(void *ctx, unsigned char *buf, size_t len)
+{
+    return TlsSocketBio::recv(bench_socket, buf, len);
+}
+
+static void transport_close()
+{
+    if (bench_socket) {
+        bench_socket->close();
+        delete bench_socket;
+        bench_socket = NULL;
+    }
+}
+
+#else
+
+static int bench_fd = -1;
+
+static uint32_t bench_now_us()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint32_t)(ts.tv_sec * 1000000ULL + ts.tv_nsec / 1000);
+}
+
+static uint32_t bench_cpu_mhz()
+{
+    return TLS_BENCH_HOST_MHZ;
+}
+
+static int transport_connect(const char *host, uint16_t port)
+{
+    struct addrinfo hints, *ai;
+    char service[8];
+
+    memset(&hints, 0, sizeof(hints));
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_socktype = SOCK_STREAM;
+    snprintf(service, sizeof(service), "%u", port);
+    if (getaddrinfo(host, service, &hints, &ai) != 0) {
+        return -1;
+    }
+
+    bench_fd = socket(ai->ai_family, ai->ai_socktype, ai->ai_protocol);
+    if (bench_fd < 0 || connect(bench_fd, ai->ai_addr, ai->ai_addrlen) != 0) {
+        if (bench_fd >= 0) {
+            close(bench_fd);
+        }
+        bench_fd = -1;
+        freeaddrinfo(ai);
+        return -1;
+    }
+    freeaddrinfo(ai);
+    return 0;
+}
+
+static int transport_send(void *ctx, const unsigned char *buf, size_t len)
+{
+    uint32_t t0 = bench_now_us();
+    ssize_t n = send(bench_fd, buf, len, 0);
+    send_us += bench_now_us() - t0;
+    return n < 0 ? -1 : (int) n;
+}
+
+static int transport_recv(void *ctx, unsigned char *buf, size_t len)
+{
+    ssize_t n = recv(bench_fd, buf, len, 0);
+    return n < 0 ? -1 : (int) n;
+}
+
+static void transport_close()
+{
+    if (bench_fd >= 0) {
+        close(bench_fd);
+        bench_fd = -1;
+    }
+}
+
+#endif
+
+/*
+ * Benchmark, the same on the device and on the host
+ */
+
+static void print_error(const char *name, int err)
+{
+    char buf[128];
+    mbedtls_strerror(err, buf, sizeof(buf));
+    printf("%s failed: -0x%04x: %s\r\n", name, -err, buf);
+}
+
+/* Which phase a handshake step belongs to, by the state it starts in */
+static Phase phase_of(int state)
+{
+    if (state <= MBEDTLS_SSL_SERVER_HELLO_DONE) {
+        return PHASE_HELLO;
+    }
+    if (state <= MBEDTLS_SSL_CERTIFICATE_VERIFY) {
+        return PHASE_KEY_EXCHANGE;
+    }
+    return PHASE_FINISHED;
+}
+
+static int run_suite(const char *host, uint16_t port, int suite_id, BenchResult *r)
+{
+    mbedtls_ssl_config conf;
+    mbedtls_ssl_context ssl;
+    int forced[2] = { suite_id, 0 };
+    int ret;
+
+    memset(r, 0, sizeof(*r));
+#if defined(MBEDTLS_PLATFORM_MEMORY)
+    size_t heap_base = heap_now;
+    heap_peak = heap_now;
+#endif
+    mbedtls_ssl_config_init(&conf);
+    mbedtls_ssl_init(&ssl);
+
+    ret = mbedtls_ssl_config_defaults(&conf, MBEDTLS_SSL_IS_CLIENT, MBEDTLS_SSL_TRANSPORT_STREAM,
+                                      MBEDTLS_SSL_PRESET_DEFAULT);
+    if (ret != 0) {
+        print_error("mbedtls_ssl_config_defaults", ret);
+        goto exit;
+    }
+    mbedtls_ssl_conf_rng(&conf, mbedtls_ctr_drbg_random, &ctr_drbg);
+    mbedtls_ssl_conf_ciphersuites(&conf, forced);
+    /* The bench server has a throwaway certificate: parse it, do not insist */
+    mbedtls_ssl_conf_authmode(&conf, MBEDTLS_SSL_VERIFY_OPTIONAL);
+#if defined(TLS_MEMORY_MAX_FRAG_LEN) && defined(MBEDTLS_SSL_MAX_FRAGMENT_LENGTH)
+    mbedtls_ssl_conf_max_frag_len(&conf, TLS_MEMORY_MAX_FRAG_LEN);
+#endif
+
+    ret = mbedtls_ssl_setup(&ssl, &conf);
+    if (ret != 0) {
+        print_error("mbedtls_ssl_setup", ret);
+        goto exit;
+    }
+    mbedtls_ssl_set_bio(&ssl, NULL, transport_send, transport_recv, NULL);
+
+    ret = transport_connect(host, port);
+    if (ret != 0) {
+        printf("connect to %s:%u failed: %d\r\n", host, port, ret);
+        goto exit;
+    }
+
+    /* Step through the handshake, charging each step to its phase */
+    while (ssl.state != MBEDTLS_SSL_HANDSHAKE_OVER) {
+        Phase phase = phase_of(ssl.state);
+        uint32_t t0 = bench_now_us();
+        ret = mbedtls_ssl_handshake_step(&ssl);
+        r->phase_us[phase] += bench_now_us() - t0;
+        if (ret != 0 && ret != MBEDTLS_ERR_SSL_WANT_READ && ret != MBEDTLS_ERR_SSL_WANT_WRITE) {
+            print_error("mbedtls_ssl_handshake_step", ret);
+            goto close;
+        }
+    }
+    for (int i = 0; i < PHASE_COUNT; i++) {
+        r->handshake_us += r->phase_us[i];
+    }
+#if defined(MBEDTLS_SSL_MAX_FRAGMENT_LENGTH)
+    r->frag_len = mbedtls_ssl_get_max_frag_len(&ssl);
+#endif
+
+    /* Push data for a fixed time, the server discards it */
+    send_us = 0;
+    {
+        uint32_t start = bench_now_us();
+        while (bench_now_us() - start < BENCH_BULK_US) {
+            ret = mbedtls_ssl_write(&ssl, bulk, sizeof(bulk));
+            if (ret == MBEDTLS_ERR_SSL_WANT_READ || ret == MBEDTLS_ERR_SSL_WANT_WRITE) {
+                continue;
+            }
+            if (ret < 0) {
+                print_error("mbedtls_ssl_write", ret);
+                goto close;
+            }
+            r->bytes += ret;
+        }
+        r->bulk_us = bench_now_us() - start;
+        r->crypto_us = r->bulk_us > send_us ? r->bulk_us - send_us : 0;
+    }
+    ret = 0;
+    mbedtls_ssl_close_notify(&ssl);
+
+close:
+    transport_close();
+exit:
+    mbedtls_ssl_free(&ssl);
+    mbedtls_ssl_config_free(&conf);
+#if defined(MBEDTLS_PLATFORM_MEMORY)
+    r->heap_peak = heap_peak - heap_base;
+#endif
+    r->error = ret;
+    return ret;
+}
+
+static void print_results()
+{
+    uint32_t mhz = bench_cpu_mhz();
+
+#if defined(TLS_MEMORY_PROFILE_NAME)
+    printf("\r\nMemory profile: %s\r\n", TLS_MEMORY_PROFILE_NAME);
+#endif
+    printf("\r\n%-44s %8s %8s %8s %8s %8s %10s %8s %6s\r\n", "suite",
+           "hello", "kex", "finished", "total ms", "MB/s", "cycles/B", "heap", "frag");
+    for (int i = 0; i < suite_count; i++) {
+        const BenchResult &r = results[i];
+        if (r.error) {
+            printf("%-44s %s\r\n", suites[i], r.error == MBEDTLS_ERR_SSL_BAD_INPUT_DATA ? "not supported" : "failed");
+            continue;
+        }
+
+        /* bytes per microsecond is MB/s, printed with two decimals */
+        uint32_t mb_100 = r.bulk_us ? (uint32_t)((uint64_t)r.bytes * 100 / r.bulk_us) : 0;
+        uint32_t cycles = r.bytes ? (uint32_t)((uint64_t)r.crypto_us * mhz / r.bytes) : 0;
+        printf("%-44s %8lu %8lu %8lu %8lu %5lu.%02lu ", suites[i],
+               (unsigned long)(r.phase_us[PHASE_HELLO] / 1000),
+               (unsigned long)(r.phase_us[PHASE_KEY_EXCHANGE] / 1000),
+               (unsigned long)(r.phase_us[PHASE_FINISHED] / 1000),
+               (unsigned long)(r.handshake_us / 1000),
+               (unsigned long)(mb_100 / 100), (unsigned long)(mb_100 % 100));
+        if (mhz) {
+            printf("%10lu", (unsigned long)cycles);
+        } else {
+            printf("%10s", "n/a");
+        }
+        printf(" %8lu %6lu\r\n", (unsigned long)r.heap_peak, (unsigned long)r.frag_len);
+    }
+}
+
+static int run_all(const char *host, uint16_t port)
+{
+    int ret;
+
+#if defined(MBEDTLS_PLATFORM_MEMORY)
+    mbedtls_platform_set_calloc_free(bench_calloc, bench_free);
+#endif
+    mbedtls_entropy_init(&entropy);
+    mbedtls_ctr_drbg_init(&ctr_drbg);
+    ret = mbedtls_ctr_drbg_seed(&ctr_drbg, mbedtls_entropy_func, &entropy,
+                                (const unsigned char *) DRBG_PERS, strlen(DRBG_PERS));
+    if (ret != 0) {
+        print_error("mbedtls_ctr_drbg_seed", ret);
+        return -1;
+    }
+    memset(bulk, 0x5A, sizeof(bulk));
+
+    for (int i = 0; i < suite_count; i++) {
+        int id = mbedtls_ssl_get_ciphersuite_id(suites[i]);
+        if (id == 0) {
+            results[i].error = MBEDTLS_ERR_SSL_BAD_INPUT_DATA;
+            printf("%s: not supported by this mbed TLS build\r\n", suites[i]);
+            continue;
+        }
+        printf("%s...\r\n", suites[i]);
+        run_suite(host, port, id, &results[i]);
+    }
+
+    print_results();
+    mbedtls_ctr_drbg_free(&ctr_drbg);
+    mbedtls_entropy_free(&entropy);
+#if defined(MBEDTLS_PLATFORM_MEMORY)
+    mbedtls_platform_set_calloc_free(calloc, free);
+#endif
+    return 0;
+}
+
+#if defined(__MBED__)
+
+int app_tls_bench()
+{
+    EMW10xxInterface wifi_iface;
+
+#if defined(MBED_CONF_APP_TLS_BENCH_HOST)
+    const char *host = MBED_CONF_APP_TLS_BENCH_HOST;
+#else
+    const char *host = NULL;
+#endif
+    if (!host) {
+        printf("Set tls-bench-host in mbed_app.json to the TLS server\r\n");
+        return -1;
+    }
+
+    int ret = wifi_iface.connect(MBED_CONF_APP_WIFI_SSID, MBED_CONF_APP_WIFI_PASSWORD, NSAPI_SECURITY_WPA_WPA2, 0);
+    if (ret != 0) {
+        printf("\r\nConnection error\r\n");
+        return -1;
+    }
+    printf("IP: %s, server %s:%d, CPU %lu MHz\r\n", wifi_iface.get_ip_address(), host,
+           MBED_CONF_APP_TLS_BENCH_PORT, (unsigned long)bench_cpu_mhz());
+    bench_net = &wifi_iface;
+
+    ret = run_all(host, MBED_CONF_APP_TLS_BENCH_PORT);
+    wifi_iface.disconnect();
+    return ret;
+}
+
+#else
+
+int main(int argc, char **argv)
+{
+    const char *host = argc > 1 ? argv[1] : "127.0.0.1";
+    uint16_t port = argc > 2 ? atoi(argv[2]) : 4433;
+
+    return run_all(host, port) == 0 ? 0 : 1;
+}
+
+#endif
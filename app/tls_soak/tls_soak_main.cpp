@@ -0,0 +1,243 @@
+/* TLS reconnect soak
+ * Copyright (c) 2017 MXCHIP Information Tech. Co.,Ltd
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/** \file tls_soak_main.cpp
+ *  \brief Connect, handshake and close thousands of times against the
+ *  tls_bench server and watch the heap stay flat.
+ *
+ *  The first pass lets mbed TLS allocate from the system heap through the
+ *  counting TlsAllocator, the second serves every connection from an arena
+ *  that is released as a whole when the connection is closed. Every
+ *  TLS_SOAK_REPORT rounds the bytes mbed TLS holds, its peak and the system
+ *  heap are printed; at the end of a pass the heap is compared with the
+ *  first report. A heap that keeps growing, blocks left in the arena or
+ *  arena fallbacks are what this is looking for.
+ *
+ *  Start the server as described in tls_bench_main.cpp and set
+ *  tls-bench-host in mbed_app.json.
+ */
+
+#include "mbed.h"
+#include "mbed_stats.h"
+#include "TCPSocket.h"
+#include "EMW10xxInterface.h"
+#include "TlsAllocator.h"
+#include "TlsSocketBio.h"
+
+#include "mbedtls/platform.h"
+#include "mbedtls/ssl.h"
+#include "mbedtls/entropy.h"
+#include "mbedtls/ctr_drbg.h"
+#include "mbedtls/error.h"
+
+namespace {
+
+const int TLS_SOAK_ROUNDS = 2000;
+const int TLS_SOAK_REPORT = 200;
+
+/* Both record buffers plus the handshake: certificate, key exchange */
+#if defined(MBEDTLS_SSL_IN_CONTENT_LEN) && defined(MBEDTLS_SSL_OUT_CONTENT_LEN)
+const size_t TLS_SOAK_RECORD_BUFFERS = MBEDTLS_SSL_IN_CONTENT_LEN + MBEDTLS_SSL_OUT_CONTENT_LEN;
+#else
+const size_t TLS_SOAK_RECORD_BUFFERS = 2 * MBEDTLS_SSL_MAX_CONTENT_LEN;
+#endif
+const size_t TLS_SOAK_ARENA_SIZE = TLS_SOAK_RECORD_BUFFERS + 16 * 1024;
+
+const char *DRBG_PERS = "tls soak";
+
+struct SoakResult {
+    int handshakes;
+    int failures;
+    int leaked_blocks;
+    long heap_drift;
+};
+
+NetworkInterface *soak_net;
+
+mbedtls_entropy_context entropy;
+mbedtls_ctr_drbg_context ctr_drbg;
+mbedtls_ssl_config conf;
+
+}
+
+static void print_error(const char *name, int err)
+{
+    char buf[128];
+    mbedtls_strerror(err, buf, sizeof(buf));
+    printf("%s failed: -0x%04x: %s\r\n", name, -err, buf);
+}
+
+static uint32_t system_heap()
+{
+#if defined(MBED_HEAP_STATS_ENABLED)
+    mbed_stats_heap_t heap;
+    mbed_stats_heap_get(&heap);
+    return heap.current_size;
+#else
+    return 0;
+#endif
+}
+
+/* One full connection: TCP connect, handshake, close_notify, free */
+static int soak_round(const char *host, uint16_t port)
+{
+    mbedtls_ssl_context ssl;
+    TCPSocket socket(soak_net);
+    int ret;
+
+    mbedtls_ssl_init(&ssl);
+    ret = mbedtls_ssl_setup(&ssl, &conf);
+    if (ret != 0) {
+        print_error("mbedtls_ssl_setup", ret);
+        goto exit;
+    }
+    mbedtls_ssl_set_bio(&ssl, &socket, TlsSocketBio::send, TlsSocketBio::recv, NULL);
+
+    ret = socket.connect(host, port);
+    if (ret != 0) {
+        printf("connect to %s:%u failed: %d\r\n", host, port, ret);
+        goto exit;
+    }
+
+    do {
+        ret = mbedtls_ssl_handshake(&ssl);
+    } while (ret == MBEDTLS_ERR_SSL_WANT_READ || ret == MBEDTLS_ERR_SSL_WANT_WRITE);
+    if (ret != 0) {
+        print_error("mbedtls_ssl_handshake", ret);
+    } else {
+        mbedtls_ssl_close_notify(&ssl);
+    }
+    socket.close();
+
+exit:
+    mbedtls_ssl_free(&ssl);
+    return ret;
+}
+
+static void soak(const char *title, const char *host, uint16_t port, uint8_t *arena, SoakResult *r)
+{
+    uint32_t heap_base = 0;
+
+    memset(r, 0, sizeof(*r));
+    printf("\r\n%s, %d rounds\r\n", title, TLS_SOAK_ROUNDS);
+    printf("%8s %8s %10s %10s %10s\r\n", "round", "failed", "tls now", "tls peak", "heap");
+    TlsAllocator::reset_peak();
+
+    for (int round = 1; round <= TLS_SOAK_ROUNDS; round++) {
+        if (arena) {
+            TlsAllocator::use_arena(arena, TLS_SOAK_ARENA_SIZE);
+        }
+        if (soak_round(host, port) == 0) {
+            r->handshakes++;
+        } else {
+            r->failures++;
+        }
+        if (arena) {
+            r->leaked_blocks += TlsAllocator::release_arena();
+        }
+
+        if (round % TLS_SOAK_REPORT == 0) {
+            const TlsAllocator::Stats &s = TlsAllocator::stats();
+            uint32_t heap = system_heap();
+            printf("%8d %8d %10lu %10lu %10lu\r\n", round, r->failures, (unsigned long)s.current,
+                   (unsigned long)s.peak, (unsigned long)heap);
+            /* The first rounds warm up lwIP and the driver, measure from here */
+            if (round == TLS_SOAK_REPORT) {
+                heap_base = heap;
+            }
+            r->heap_drift = (long)heap - (long)heap_base;
+        }
+    }
+
+    printf("%d handshakes, %d failed, heap drift %ld bytes since round %d\r\n",
+           r->handshakes, r->failures, r->heap_drift, TLS_SOAK_REPORT);
+    if (arena) {
+        printf("arena %lu bytes, %d blocks left at release\r\n",
+               (unsigned long)TLS_SOAK_ARENA_SIZE, r->leaked_blocks);
+    }
+    TlsAllocator::print_stats("mbed TLS heap");
+}
+
+int app_tls_soak()
+{
+    EMW10xxInterface wifi_iface;
+    SoakResult heap_result, arena_result;
+
+#if defined(MBED_CONF_APP_TLS_BENCH_HOST)
+    const char *host = MBED_CONF_APP_TLS_BENCH_HOST;
+#else
+    const char *host = NULL;
+#endif
+    if (!host) {
+        printf("Set tls-bench-host in mbed_app.json to the TLS server\r\n");
+        return -1;
+    }
+
+    int ret = wifi_iface.connect(MBED_CONF_APP_WIFI_SSID, MBED_CONF_APP_WIFI_PASSWORD, NSAPI_SECURITY_WPA_WPA2, 0);
+    if (ret != 0) {
+        printf("\r\nConnection error\r\n");
+        return -1;
+    }
+    printf("IP: %s, server %s:%d\r\n", wifi_iface.get_ip_address(), host, MBED_CONF_APP_TLS_BENCH_PORT);
+#if defined(TLS_MEMORY_PROFILE_NAME)
+    printf("Memory profile: %s\r\n", TLS_MEMORY_PROFILE_NAME);
+#endif
+    soak_net = &wifi_iface;
+
+    /* The shared state lives on the system heap for both passes */
+    TlsAllocator::install();
+    mbedtls_entropy_init(&entropy);
+    mbedtls_ctr_drbg_init(&ctr_drbg);
+    mbedtls_ssl_config_init(&conf);
+    uint8_t *arena = new uint8_t[TLS_SOAK_ARENA_SIZE];
+
+    ret = mbedtls_ctr_drbg_seed(&ctr_drbg, mbedtls_entropy_func, &entropy,
+                                (const unsigned char *) DRBG_PERS, strlen(DRBG_PERS));
+    if (ret != 0) {
+        print_error("mbedtls_ctr_drbg_seed", ret);
+        goto exit;
+    }
+    ret = mbedtls_ssl_config_defaults(&conf, MBEDTLS_SSL_IS_CLIENT, MBEDTLS_SSL_TRANSPORT_STREAM,
+                                      MBEDTLS_SSL_PRESET_DEFAULT);
+    if (ret != 0) {
+        print_error("mbedtls_ssl_config_defaults", ret);
+        goto exit;
+    }
+    mbedtls_ssl_conf_rng(&conf, mbedtls_ctr_drbg_random, &ctr_drbg);
+    /* The bench server has a throwaway certificate: parse it, do not insist */
+    mbedtls_ssl_conf_authmode(&conf, MBEDTLS_SSL_VERIFY_OPTIONAL);
+#if defined(TLS_MEMORY_MAX_FRAG_LEN) && defined(MBEDTLS_SSL_MAX_FRAGMENT_LENGTH)
+    mbedtls_ssl_conf_max_frag_len(&conf, TLS_MEMORY_MAX_FRAG_LEN);
+#endif
+
+    soak("System heap", host, MBED_CONF_APP_TLS_BENCH_PORT, NULL, &heap_result);
+    soak("Arena per connection", host, MBED_CONF_APP_TLS_BENCH_PORT, arena, &arena_result);
+
+    printf("\r\n%-22s %10s %8s %12s\r\n", "", "handshakes", "failed", "heap drift");
+    printf("%-22s %10d %8d %12ld\r\n", "system heap", heap_result.handshakes,
+           heap_result.failures, heap_result.heap_drift);
+    printf("%-22s %10d %8d %12ld\r\n", "arena per connection", arena_result.handshakes,
+           arena_result.failures, arena_result.heap_drift);
+
+exit:
+    mbedtls_ssl_config_free(&conf);
+    mbedtls_ctr_drbg_free(&ctr_drbg);
+    mbedtls_entropy_free(&entropy);
+    TlsAllocator::uninstall();
+    delete[] arena;
+    wifi_iface.disconnect();
+    return ret;
+}
@@ -11,6 +11,14 @@ int main( void )
    RUN_APPLICATION( mbed_wifi );
    //RUN_APPLICATION( mbed_tls_client );
    //RUN_APPLICATION( mbed_tcp_udp );
+   //RUN_APPLICATION( echo_udp_server );
+   //RUN_APPLICATION( reactor_bench );
+   //RUN_APPLICATION( fast_connect );
+   //RUN_APPLICATION( net_bench );
+   //RUN_APPLICATION( tls_bench );
+   //RUN_APPLICATION( ecc_bench );
+   //RUN_APPLICATION( tls_soak );
+   //RUN_APPLICATION( dtls_bench );
 //    RUN_APPLICATION( soft_ap );
    //RUN_APPLICATION( audio );
 